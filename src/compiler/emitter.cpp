@@ -0,0 +1,293 @@
+module compiler.emitter;
+
+import stormkit.core;
+
+import grid;
+import charset;
+import engine.rewriterule;
+import engine.rulenode;
+import engine.fields;
+import engine.observes;
+
+namespace stk  = stormkit;
+namespace stdr = std::ranges;
+namespace stdv = std::views;
+
+namespace compiler {
+
+namespace {
+
+/** Every character escaped, so that any alphabet makes a valid literal */
+auto literal(std::string_view s) noexcept -> std::string {
+  auto result = std::string{ "\"" };
+  for (auto c : s) result += std::format("\\x{:02x}", static_cast<unsigned char>(c));
+  return result + "\"";
+}
+
+auto literal(char c) noexcept -> std::string {
+  return std::format("'\\x{:02x}'", static_cast<unsigned char>(c));
+}
+
+auto literal(double d) noexcept -> std::string {
+  auto result = std::format("{}", d);
+  if (result.find_first_of(".e") == std::string::npos) result += ".0";
+  return result;
+}
+
+auto literal(bool b) noexcept -> std::string {
+  return b ? "true" : "false";
+}
+
+/** Grid value of cell (x, y, z) of a rule anchored on base */
+auto cell(std::size_t x, std::size_t y, std::size_t z) noexcept -> std::string {
+  auto index = std::string{ "base" };
+  const auto term = [&index](std::size_t n, std::string_view stride) noexcept {
+    if (n == 1u)     index += std::format(" + {}", stride);
+    else if (n > 1u) index += std::format(" + {} * {}", n, stride);
+  };
+  term(z, "plane");
+  term(y, "row");
+  if (x > 0u) index += std::format(" + {}", x);
+  return std::format("values[{}]", index);
+}
+
+constexpr auto MATCH_PARAMETERS =
+  "([[maybe_unused]] const std::uint8_t* values, [[maybe_unused]] std::size_t row,"
+  " [[maybe_unused]] std::size_t plane, [[maybe_unused]] std::size_t base) noexcept";
+constexpr auto CHANGES_PARAMETERS =
+  "([[maybe_unused]] const std::uint8_t* values, [[maybe_unused]] std::size_t row,"
+  " [[maybe_unused]] std::size_t plane, [[maybe_unused]] std::size_t base,"
+  " [[maybe_unused]] std::uint32_t* cells, [[maybe_unused]] std::uint8_t* writes) noexcept";
+
+struct Tables {
+  /** Symbols of the model, a rule cell accepting all of them being left untested */
+  charset alphabet = {};
+
+  std::vector<charset>     charsets = {};
+  std::vector<std::string> unions   = {};
+  std::vector<std::string> rules    = {};
+  std::vector<std::string> inputs   = {};
+  std::vector<std::string> outputs  = {};
+  std::vector<std::string> fields   = {};
+  std::vector<std::string> observes = {};
+  std::vector<std::string> nodes    = {};
+
+  /** Generated walks, each distinct body being emitted once */
+  std::vector<std::string>           functions = {};
+  std::map<std::string, std::string> named     = {};
+
+  auto function(std::string_view prefix, std::string_view parameters, std::string body) noexcept -> std::string {
+    auto key = std::format("{}{}", parameters, body);
+    if (auto it = named.find(key); it != stdr::end(named)) return it->second;
+
+    auto name = std::format("{}_{}", prefix, stdr::size(functions));
+    functions.push_back(std::format("{} {}{} {{\n{}}}\n", prefix == "match" ? "bool" : "std::size_t", name, parameters, body));
+    named.emplace(std::move(key), name);
+    return name;
+  }
+
+  /** Test of a cell value against the symbols a rule cell accepts, none when it accepts them all */
+  auto test(const charset& values, std::string_view value) noexcept -> std::optional<std::string> {
+    const auto accepted = values & alphabet;
+    const auto count    = stdr::size(accepted);
+    if (accepted == alphabet) return std::nullopt;
+    if (count == 0u)          return "false";
+    if (count == 1u)          return std::format("{} == {}", value, *stdr::begin(accepted));
+    if (count + 1u == stdr::size(alphabet)) {
+      const auto missing = stdr::find_if(alphabet, [&accepted](auto c) noexcept { return not accepted.contains(c); });
+      return std::format("{} != {}", value, *missing);
+    }
+    if (alphabet.next(charset::WORD_BITS) == charset::CAPACITY) {
+      return std::format("((std::uint64_t{{ {:#x} }} >> {}) & 1u) != 0u", accepted.words[0], value);
+    }
+    return std::format("aot::contains(charsets[{}], {})", index(accepted), value);
+  }
+
+  /** Input test of a rule as a single expression over its constrained cells, in the order of the cells */
+  auto match(const RewriteRule& rule) noexcept -> std::string {
+    const auto size = rule.input.area().size;
+    auto tests = std::vector<std::string>{};
+    for (auto [r, i] : stdv::enumerate(rule.input.values)) {
+      if (not i) continue;
+      const auto c = static_cast<std::size_t>(r);
+      if (auto t = test(*i, cell(c % size.x, c / size.x % size.y, c / size.x / size.y))) tests.push_back(std::move(*t));
+    }
+
+    auto body = std::string{ "  return " };
+    if (stdr::empty(tests)) body += "true";
+    for (auto [k, t] : stdv::enumerate(tests)) body += k == 0 ? t : std::format("\n     and {}", t);
+    return function("match", MATCH_PARAMETERS, body + ";\n");
+  }
+
+  /** Output writes of a rule, each written cell compared to the grid so that only actual changes are told */
+  auto changes(const RewriteRule& rule) noexcept -> std::string {
+    const auto size = rule.output.area().size;
+    auto body = std::string{ "  auto n = std::size_t{ 0 };\n" };
+    for (auto [r, o] : stdv::enumerate(rule.output.values)) {
+      if (not o) continue;
+      const auto c = static_cast<std::size_t>(r);
+      body += std::format(
+        "  if ({} != {}) {{ cells[n] = {}u; writes[n++] = std::uint8_t{{ {} }}; }}\n",
+        cell(c % size.x, c / size.x % size.y, c / size.x / size.y), *o, c, *o
+      );
+    }
+    return function("changes", CHANGES_PARAMETERS, body + "  return n;\n");
+  }
+
+  auto index(const charset& values) noexcept -> std::size_t {
+    auto it = stdr::find(charsets, values);
+    if (it != stdr::end(charsets)) return static_cast<std::size_t>(stdr::distance(stdr::begin(charsets), it));
+    charsets.push_back(values);
+    return stdr::size(charsets) - 1u;
+  }
+
+  auto rule(const RewriteRule& rule) noexcept -> void {
+    const auto extents = rule.input.extents;
+    rules.push_back(std::format(
+      "{{ .extents = {{ {}, {}, {} }}, .cells = {}, .p = {}, .is_copy = {}, .match = {}, .changes = {} }}",
+      extents.extent(0), extents.extent(1), extents.extent(2),
+      stdr::size(inputs), literal(rule.draw.p()), literal(rule.is_copy),
+      match(rule), changes(rule)
+    ));
+    for (const auto& [i, o] : stdv::zip(rule.input, rule.output)) {
+      inputs.push_back(i ? std::format("{}", index(*i)) : "-1");
+      outputs.push_back(o ? std::format("{}", *o) : "-1");
+    }
+  }
+
+  auto node(const NodeRunner& runner) noexcept -> void {
+    if (auto p = std::get_if<TreeRunner>(&runner); p != nullptr) {
+      nodes.push_back(std::format(
+        "{{ .kind = aot::Node::{}, .children = {} }}",
+        p->mode == TreeRunner::Mode::MARKOV ? "MARKOV" : "SEQUENCE",
+        stdr::size(p->nodes)
+      ));
+      stdr::for_each(p->nodes, std::bind_front(&Tables::node, this));
+      return;
+    }
+
+    const auto& rulerunner = std::get<RuleRunner>(runner);
+    const auto& rulenode   = rulerunner.rulenode;
+
+    const auto rule_first = stdr::size(rules);
+    stdr::for_each(rulenode.rules, std::bind_front(&Tables::rule, this));
+
+    /* sorted, so that the output doesn't depend on hashing */
+    const auto union_first = stdr::size(unions);
+    for (const auto& [c, values] : rulenode.unions | stdr::to<std::map>()) {
+      unions.push_back(std::format("{{ {}, {} }}", literal(c), index(values)));
+    }
+
+    const auto field_first = stdr::size(fields);
+    for (const auto& [s, f] : rulenode.fields | stdr::to<std::map>()) {
+      fields.push_back(std::format(
+        "{{ {}, {}, {}, {}, {}, {} }}",
+        s, literal(f.recompute), literal(f.essential), literal(f.inversed),
+        index(f.substrate), index(f.zero)
+      ));
+    }
+
+    const auto observe_first = stdr::size(observes);
+    for (const auto& [s, o] : rulenode.observes | stdr::to<std::map>()) {
+      observes.push_back(std::format(
+        "{{ {}, {}, {} }}",
+        s, o.from ? static_cast<int>(*o.from) : -1, index(o.to)
+      ));
+    }
+
+    const auto kind =
+        rulenode.mode == RuleNode::Mode::ONE ? "ONE"
+      : rulenode.mode == RuleNode::Mode::ALL ? "ALL"
+      :                                        "PRL";
+    const auto inference =
+        rulenode.inference == RuleNode::Inference::DISTANCE ? "DISTANCE"
+      : rulenode.inference == RuleNode::Inference::OBSERVE  ? "OBSERVE"
+      : rulenode.inference == RuleNode::Inference::SEARCH   ? "SEARCH"
+      :                                                       "RANDOM";
+
+    nodes.push_back(std::format(
+      "{{ .kind = aot::Node::{}, .steps = {}, .inference = aot::Node::{}, .temperature = {}, .limit = {}, .depth_coefficient = {},"
+      " .rules = {}, .rule_count = {}, .unions = {}, .union_count = {},"
+      " .fields = {}, .field_count = {}, .observes = {}, .observe_count = {} }}",
+      kind, rulerunner.steps, inference, literal(rulenode.temperature), rulenode.limit, literal(rulenode.depthCoefficient),
+      rule_first,    stdr::size(rules)    - rule_first,
+      union_first,   stdr::size(unions)   - union_first,
+      field_first,   stdr::size(fields)   - field_first,
+      observe_first, stdr::size(observes) - observe_first
+    ));
+  }
+};
+
+/** Zero-sized arrays being ill-formed, empty tables are left out and referred to as nullptr */
+auto table(std::string& out, std::string_view type, std::string_view name, std::span<const std::string> rows) noexcept -> std::string {
+  if (stdr::empty(rows)) return "nullptr";
+
+  out += std::format("constexpr {} {}[] = {{\n", type, name);
+  for (const auto& row : rows) out += std::format("  {},\n", row);
+  out += "};\n\n";
+  return std::string{ name };
+}
+
+}
+
+auto emit(const Model& model, std::string_view name, std::string_view source, std::optional<std::uint64_t> seed) noexcept -> std::string {
+  auto tables = Tables{ .alphabet = charset{ std::from_range, stdv::iota(0uz, stdr::size(model.symbols)) } };
+  tables.node(model.program);
+
+  auto out = std::format(
+    "// Generated by mjc from {}, do not edit\n"
+    "#include \"engine/aot.h\"\n"
+    "\n"
+    "namespace {{\n"
+    "\n",
+    source
+  );
+
+  const auto charsets = table(out, "aot::Charset", "charsets",
+    tables.charsets
+      | stdv::transform([](const auto& values) static noexcept {
+          const auto& w = values.words;
+          return std::format("{{{{ {:#x}u, {:#x}u, {:#x}u, {:#x}u }}}}", w[0], w[1], w[2], w[3]);
+      })
+      | stdr::to<std::vector>()
+  );
+  /* the walks read the charsets their symbols don't fit a word of, and the rules point at the walks */
+  for (const auto& f : tables.functions) out += f + "\n";
+
+  const auto unions   = table(out, "aot::Union",    "unions",   tables.unions);
+  const auto rules    = table(out, "aot::Rule",     "rules",    tables.rules);
+  const auto inputs   = table(out, "std::int32_t",  "inputs",   tables.inputs);
+  const auto outputs  = table(out, "std::int16_t",  "outputs",  tables.outputs);
+  const auto fields   = table(out, "aot::Field",    "fields",   tables.fields);
+  const auto observes = table(out, "aot::Observe",  "observes", tables.observes);
+  const auto nodes    = table(out, "aot::Node",     "nodes",    tables.nodes);
+
+  out += std::format(
+    "constexpr aot::Model model = {{\n"
+    "  .name     = {},\n"
+    "  .symbols  = {},\n"
+    "  .origin   = {},\n"
+    "  .seeded   = {},\n"
+    "  .seed     = {}u,\n"
+    "  .charsets = {},\n"
+    "  .unions   = {},\n"
+    "  .rules    = {},\n"
+    "  .inputs   = {},\n"
+    "  .outputs  = {},\n"
+    "  .fields   = {},\n"
+    "  .observes = {},\n"
+    "  .nodes    = {},\n"
+    "}};\n"
+    "\n"
+    "const auto registration = aot::Registration{{ model }};\n"
+    "\n"
+    "}}\n",
+    literal(name), literal(std::string_view{ model.symbols }), literal(model.origin),
+    literal(seed.has_value()), seed.value_or(0u),
+    charsets, unions, rules, inputs, outputs, fields, observes, nodes
+  );
+
+  return out;
+}
+
+}
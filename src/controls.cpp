@@ -39,6 +39,10 @@ void Controls::wait_unpause(std::stop_token stop) {
   pause_cv.wait(l, [&paused = model_paused, &stop]{ return stop.stop_requested() or not paused; });
 }
 
+bool Controls::fast_forward() const {
+  return (not ratelimit_enabled or tickrate == 0) and not next_frame;
+}
+
 void Controls::rate_limit(Controls::clock::time_point last_time) {
   if (not ratelimit_enabled or tickrate == 0 or next_frame) {
     return;
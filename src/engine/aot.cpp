@@ -0,0 +1,189 @@
+module;
+#include "aot.h"
+module engine.aot;
+
+import stormkit.core;
+
+import grid;
+import charset;
+import engine.rewriterule;
+import engine.rulenode;
+import engine.fields;
+import engine.observes;
+import parser;
+
+namespace stk  = stormkit;
+namespace stdr = std::ranges;
+namespace stdv = std::views;
+
+namespace aot {
+
+namespace {
+
+auto values(const Charset& baked) noexcept -> charset {
+  auto result = charset{};
+  stdr::copy(baked.words, stdr::begin(result.words));
+  return result;
+}
+
+template <class T>
+auto slice(const T* data, std::uint32_t first, std::uint32_t count) noexcept -> std::span<const T> {
+  return count == 0u ? std::span<const T>{} : std::span{ data + first, count };
+}
+
+auto rule(const Model& model, const Rule& baked) noexcept -> RewriteRule {
+  const auto extents = std::dims<3>{ baked.extents[0], baked.extents[1], baked.extents[2] };
+  const auto cells   = baked.extents[0] * baked.extents[1] * baked.extents[2];
+
+  auto result = RewriteRule{
+    { std::from_range,
+      slice(model.inputs, baked.cells, cells)
+        | stdv::transform([&model](auto i) noexcept {
+            return i < 0 ? RewriteRule::Input{} : RewriteRule::Input{ values(model.charsets[i]) };
+        }),
+      extents },
+    { std::from_range,
+      slice(model.outputs, baked.cells, cells)
+        | stdv::transform([](auto o) static noexcept {
+            return o < 0 ? RewriteRule::Output{} : RewriteRule::Output{ static_cast<symbol>(o) };
+        }),
+      extents },
+    baked.p,
+    baked.is_copy
+  };
+  result.kernel.baked_match   = baked.match;
+  result.kernel.baked_changes = baked.changes;
+  return result;
+}
+
+auto rulenode(const Model& model, const Node& baked) noexcept -> ::RuleNode {
+  const auto mode =
+      baked.kind == Node::ONE ? ::RuleNode::Mode::ONE
+    : baked.kind == Node::ALL ? ::RuleNode::Mode::ALL
+    :                           ::RuleNode::Mode::PRL;
+
+  auto rules = slice(model.rules, baked.rules, baked.rule_count)
+    | stdv::transform(std::bind_front(rule, std::cref(model)))
+    | stdv::as_rvalue
+    | stdr::to<std::vector>();
+
+  auto unions = slice(model.unions, baked.unions, baked.union_count)
+    | stdv::transform([&model](const auto& u) noexcept {
+        return std::pair{ u.symbol, values(model.charsets[u.values]) };
+    })
+    | stdr::to<RewriteRule::Unions>();
+
+  const auto observes = [&model, &baked] noexcept {
+    return slice(model.observes, baked.observes, baked.observe_count)
+      | stdv::transform([&model](const auto& o) noexcept {
+          return std::pair{
+            symbol{ o.value },
+            ::Observe{
+              o.from < 0 ? std::nullopt : std::optional{ static_cast<symbol>(o.from) },
+              values(model.charsets[o.to])
+            }
+          };
+      })
+      | stdr::to<::Observes>();
+  };
+
+  switch (baked.inference) {
+    case Node::SEARCH:
+      return ::RuleNode{
+        mode, std::move(rules), std::move(unions),
+        observes(),
+        static_cast<stk::cpp::UInt>(baked.limit),
+        baked.depth_coefficient
+      };
+    case Node::OBSERVE:
+      return ::RuleNode{
+        mode, std::move(rules), std::move(unions),
+        observes(),
+        baked.temperature
+      };
+    case Node::DISTANCE:
+      return ::RuleNode{
+        mode, std::move(rules), std::move(unions),
+        slice(model.fields, baked.fields, baked.field_count)
+          | stdv::transform([&model](const auto& f) noexcept {
+              return std::pair{
+                symbol{ f.symbol },
+                ::Field{
+                  f.recompute, f.essential, f.inversed,
+                  values(model.charsets[f.substrate]),
+                  values(model.charsets[f.zero])
+                }
+              };
+          })
+          | stdr::to<::Fields>(),
+        baked.temperature
+      };
+    case Node::RANDOM:
+      return ::RuleNode{ mode, std::move(rules), std::move(unions) };
+  }
+  std::unreachable();
+}
+
+/** Reads the node at i and its subtrees, leaving i past them */
+auto node(const Model& model, std::uint32_t& i) noexcept -> NodeRunner {
+  const auto& baked = model.nodes[i++];
+
+  if (baked.kind == Node::MARKOV or baked.kind == Node::SEQUENCE) {
+    auto nodes = std::vector<NodeRunner>{};
+    for (auto c = 0u; c < baked.children; ++c) nodes.emplace_back(node(model, i));
+    return { TreeRunner{
+      baked.kind == Node::MARKOV ? TreeRunner::Mode::MARKOV : TreeRunner::Mode::SEQUENCE,
+      std::move(nodes)
+    } };
+  }
+
+  return { RuleRunner{ rulenode(model, baked), static_cast<stk::cpp::UInt>(baked.steps) } };
+}
+
+}
+
+auto find(std::string_view name) noexcept -> const Model* {
+  for (auto r = Registration::head(); r != nullptr; r = r->next) {
+    if (r->model.name == name) return &r->model;
+  }
+  return nullptr;
+}
+
+auto load(const Model& model, std::optional<std::uint64_t> seed) noexcept -> ::Model {
+  auto symbols = std::string{ model.symbols };
+
+  auto ids = stdv::iota(0uz, stdr::size(symbols))
+    | stdv::transform([](auto i) static noexcept { return static_cast<symbol>(i); });
+
+  auto unions = RewriteRule::Unions{};
+  unions.emplace(RewriteRule::IGNORED_SYMBOL, charset{ std::from_range, ids });
+  unions.insert_range(stdv::zip(symbols, ids) | stdv::transform([](auto&& ci) static noexcept {
+    auto [c, i] = ci;
+    return std::pair{ c, charset{ i } };
+  }));
+
+  auto i = 0u;
+  auto program = node(model, i);
+
+  const auto s = seed.value_or(model.seeded ? model.seed : std::random_device{}());
+  reseed(program, s);
+
+  auto fields = std::make_shared<Field::Store>();
+  share(program, fields);
+
+  return ::Model{
+    std::move(symbols),
+    std::move(unions),
+    model.origin,
+    std::move(program),
+    s,
+    std::move(fields)
+  };
+}
+
+auto load(const std::filesystem::path& file, std::optional<std::uint64_t> seed) noexcept -> ::Model {
+  if (const auto baked = find(file.stem().string()); baked != nullptr) return load(*baked, seed);
+  return parser::Model(parser::document(file), seed);
+}
+
+}
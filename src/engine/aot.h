@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/** Plain tables a model is baked into by mjc, read back by the engine.aot module.
+ *  Kept free of modules so that generated translation units build as ordinary C++. */
+namespace aot {
+
+/** Bits of a charset, symbol c being bit c % 64 of word c / 64 */
+struct Charset {
+  std::uint64_t words[4];
+};
+
+struct Union {
+  char          symbol;
+  std::uint32_t values;
+};
+
+/** Input test generated for a rule : the grid values, the strides of a row and of a plane, and the index of the anchor */
+using MatchFn = bool (*)(const std::uint8_t* values, std::size_t row, std::size_t plane, std::size_t base) noexcept;
+
+/** Output writes generated for a rule : the rule cells whose symbol changes and the symbols written, returning their count */
+using ChangesFn = std::size_t (*)(
+  const std::uint8_t* values, std::size_t row, std::size_t plane, std::size_t base,
+  std::uint32_t* cells, std::uint8_t* writes
+) noexcept;
+
+constexpr auto contains(const Charset& set, std::uint8_t c) noexcept -> bool {
+  return (set.words[c / 64u] >> (c % 64u)) & 1u;
+}
+
+struct Rule {
+  /** Extents as z, y, x */
+  std::uint32_t extents[3];
+  /** First cell in Model::inputs and Model::outputs, cells being laid out in z, y, x order */
+  std::uint32_t cells;
+  double        p;
+  bool          is_copy;
+  /** Straight-line code over the cells of the rule, unrolled on its extents with its symbols as constants */
+  MatchFn       match;
+  ChangesFn     changes;
+};
+
+struct Field {
+  std::uint8_t  symbol;
+  bool          recompute, essential, inversed;
+  std::uint32_t substrate, zero;
+};
+
+struct Observe {
+  std::uint8_t  value;
+  /** Symbol observed from, -1 when absent */
+  std::int16_t  from;
+  std::uint32_t to;
+};
+
+/** Nodes in preorder, a tree being followed by its subtrees */
+struct Node {
+  enum Kind : std::uint8_t { MARKOV, SEQUENCE, ONE, ALL, PRL };
+  enum Inference : std::uint8_t { RANDOM, DISTANCE, OBSERVE, SEARCH };
+
+  Kind          kind;
+  /** Direct children of a tree */
+  std::uint32_t children = 0;
+
+  std::uint32_t steps             = 0;
+  Inference     inference         = RANDOM;
+  double        temperature       = 0.0;
+  std::uint32_t limit             = 0;
+  double        depth_coefficient = 0.5;
+
+  /** Ranges of Model::rules, Model::unions, Model::fields and Model::observes */
+  std::uint32_t rules    = 0, rule_count    = 0;
+  std::uint32_t unions   = 0, union_count   = 0;
+  std::uint32_t fields   = 0, field_count   = 0;
+  std::uint32_t observes = 0, observe_count = 0;
+};
+
+struct Model {
+  const char* name;
+  const char* symbols;
+  bool        origin;
+  /** Seed attribute of the model, the fallback when none is given at load */
+  bool          seeded;
+  std::uint64_t seed;
+
+  const Charset*       charsets;
+  const Union*         unions;
+  const Rule*          rules;
+  /** Charset of each rule input cell, -1 for ignored cells */
+  const std::int32_t*  inputs;
+  /** Symbol of each rule output cell, -1 for ignored cells */
+  const std::int16_t*  outputs;
+  const Field*         fields;
+  const Observe*       observes;
+  const Node*          nodes;
+};
+
+/** Compiled models link themselves into a list during static initialization */
+struct Registration {
+  const Model&        model;
+  const Registration* next;
+
+  explicit Registration(const Model& _model) noexcept
+  : model{_model}, next{head()}
+  {
+    head() = this;
+  }
+
+  static auto head() noexcept -> const Registration*& {
+    static const Registration* first = nullptr;
+    return first;
+  }
+};
+
+}
@@ -0,0 +1,151 @@
+module engine.bitplanes;
+
+import workers;
+
+namespace stdr = std::ranges;
+namespace stdv = std::views;
+
+BitPlanes::BitPlanes(const Grid<symbol>& grid) noexcept
+: extents{ grid.extents },
+  row_words{ (extents.extent(2) + WORD_BITS - 1u) / WORD_BITS },
+  symbol_count{ stdr::empty(grid) ? 0uz : std::size_t{ stdr::max(grid.values) } + 1u },
+  words(symbol_count * extents.extent(0) * extents.extent(1) * row_words, Word{ 0 })
+{
+  const auto width = extents.extent(2);
+  const auto rows  = extents.extent(0) * extents.extent(1);
+  for (auto r = 0uz; r < rows; ++r) {
+    for (auto x = 0uz; x < width; ++x) {
+      auto c = grid.values[r * width + x];
+      words[(c * rows + r) * row_words + x / WORD_BITS] |= Word{ 1 } << (x % WORD_BITS);
+    }
+  }
+}
+
+auto BitPlanes::row(symbol c, std::size_t y, std::size_t z) const noexcept -> std::span<const Word> {
+  const auto rows = extents.extent(0) * extents.extent(1);
+  return { stdr::data(words) + (c * rows + z * extents.extent(1) + y) * row_words, row_words };
+}
+
+auto BitPlanes::row_mask(const charset& values, std::size_t y, std::size_t z, std::span<Word> mask) const noexcept -> void {
+  stdr::fill(mask, Word{ 0 });
+
+  auto present = stdr::count_if(values, [this](auto c) noexcept { return c < symbol_count; });
+
+  // a wide union is cheaper to build from the few symbols it rejects
+  auto complement = static_cast<std::size_t>(present) * 2u > symbol_count;
+  for (auto c = 0uz; c < symbol_count; ++c) {
+    if (values.contains(static_cast<symbol>(c)) == complement) continue;
+    auto plane = row(static_cast<symbol>(c), y, z);
+    for (auto w = 0uz; w < row_words; ++w) mask[w] |= plane[w];
+  }
+
+  if (complement) {
+    for (auto& w : mask) w = ~w;
+  }
+}
+
+auto BitPlanes::scan(std::span<const RewriteRule> rules) const noexcept -> std::vector<Match> {
+  const auto g_size = fromExtents(extents);
+  const auto cells  = g_size.x * g_size.y * g_size.z;
+
+  auto& workers = Workers::shared();
+
+  /* (rule, anchor rows) slabs, listed in the serial scan order */
+  auto slabs = std::vector<std::tuple<std::size_t, std::size_t, std::size_t>>{};
+  for (auto r = 0uz; r < stdr::size(rules); ++r) {
+    const auto r_size = rules[r].input.area().size;
+    if (glm::any(glm::greaterThan(r_size, g_size))) continue;
+
+    const auto rows  = (g_size.y - r_size.y + 1u) * (g_size.z - r_size.z + 1u);
+    const auto chunk = cells < PARALLEL_CELLS ? rows
+                     : std::max(rows / (4u * workers.size()), 1uz);
+    for (auto first = 0uz; first < rows; first += chunk) {
+      slabs.emplace_back(r, first, std::min(first + chunk, rows));
+    }
+  }
+
+  auto found = std::vector<std::vector<Match>>(stdr::size(slabs));
+  const auto task = [this, rules, &slabs, &found](std::size_t i) noexcept {
+    const auto [r, first, last] = slabs[i];
+    found[i] = scan(rules, r, first, last);
+  };
+
+  if (cells < PARALLEL_CELLS) {
+    for (auto i = 0uz; i < stdr::size(slabs); ++i) task(i);
+  }
+  else {
+    workers.parallel_for(stdr::size(slabs), task);
+  }
+
+  return std::move(found)
+    | stdv::join
+    | stdr::to<std::vector>();
+}
+
+auto BitPlanes::scan(
+  std::span<const RewriteRule> rules,
+  std::size_t r,
+  std::size_t first,
+  std::size_t last
+) const noexcept -> std::vector<Match> {
+  auto matches = std::vector<Match>{};
+
+  const auto g_size = fromExtents(extents);
+  auto acc  = std::vector<Word>(row_words);
+  auto mask = std::vector<Word>(row_words);
+
+  const auto& rule = rules[r];
+  const auto r_size = rule.input.area().size;
+
+  /* anchors are the positions where the whole input fits in the grid */
+  const auto a_size = g_size - r_size + Area3::Size{ 1u, 1u, 1u };
+
+  const auto cells = stdv::zip(mdiota(rule.input.area()), rule.input)
+    | stdv::filter([](const auto& ui) static noexcept { return std::get<1>(ui).has_value(); })
+    | stdv::transform([](const auto& ui) static noexcept {
+        const auto& [u, i] = ui;
+        return std::tuple{ u, *i };
+    })
+    | stdr::to<std::vector>();
+
+  for (auto row = first; row < last; ++row) {
+    const auto z = row / a_size.y;
+    const auto y = row % a_size.y;
+
+    for (auto w = 0uz; w < row_words; ++w) {
+      auto x0 = w * WORD_BITS;
+      acc[w] = x0 >= a_size.x                ? Word{ 0 }
+             : a_size.x - x0 >= WORD_BITS    ? ~Word{ 0 }
+             : (Word{ 1 } << (a_size.x - x0)) - 1u;
+    }
+
+    for (const auto& [u, values] : cells) {
+      row_mask(values, y + static_cast<std::size_t>(u.y), z + static_cast<std::size_t>(u.z), mask);
+
+      /* bit x of the anchor row tests cell x + u.x of the input row */
+      const auto word_shift = static_cast<std::size_t>(u.x) / WORD_BITS;
+      const auto bit_shift  = static_cast<std::size_t>(u.x) % WORD_BITS;
+      auto any = Word{ 0 };
+      for (auto w = 0uz; w < row_words; ++w) {
+        auto lo = w + word_shift      < row_words ? mask[w + word_shift]      : Word{ 0 };
+        auto hi = w + word_shift + 1u < row_words ? mask[w + word_shift + 1u] : Word{ 0 };
+        acc[w] &= bit_shift == 0u ? lo : (lo >> bit_shift) | (hi << (WORD_BITS - bit_shift));
+        any |= acc[w];
+      }
+      if (any == 0u) break;
+    }
+
+    for (auto w = 0uz; w < row_words; ++w) {
+      for (auto bits = acc[w]; bits != 0u; bits &= bits - 1u) {
+        auto x = w * WORD_BITS + static_cast<std::size_t>(std::countr_zero(bits));
+        matches.push_back(Match{
+          rules,
+          Area3::Offset{ x, y, z },
+          static_cast<stk::ioffset>(r)
+        });
+      }
+    }
+  }
+
+  return matches;
+}
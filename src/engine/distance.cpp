@@ -0,0 +1,256 @@
+module engine.distance;
+
+namespace stdr = std::ranges;
+
+auto Frontier::layout(std::dims<3> _extents) noexcept -> void {
+  if (_extents == extents and not stdr::empty(neighbours)) return;
+
+  extents   = _extents;
+  depth     = extents.extent(0);
+  height    = extents.extent(1);
+  width     = extents.extent(2);
+  row_words = (width + WORD_BITS - 1u) / WORD_BITS;
+
+  /* flat grids only look along their own plane */
+  neighbours.clear();
+  around.clear();
+  for (auto dz = std::ptrdiff_t{ -1 }; dz <= 1; ++dz) {
+    if (depth == 1u and dz != 0) continue;
+    for (auto dy = std::ptrdiff_t{ -1 }; dy <= 1; ++dy) {
+      if (height == 1u and dy != 0) continue;
+      neighbours.push_back({ dy, dz });
+      for (auto dx = std::ptrdiff_t{ -1 }; dx <= 1; ++dx) {
+        if (width == 1u and dx != 0) continue;
+        if (dx != 0 or dy != 0 or dz != 0) around.push_back({ dx, dy, dz });
+      }
+    }
+  }
+
+  const auto rows = depth * height;
+  open.assign(rows * row_words, Word{ 0 });
+  current.assign(rows * row_words, Word{ 0 });
+  next.assign(rows * row_words, Word{ 0 });
+  spread_row.assign(row_words, Word{ 0 });
+  listed.assign(rows, 0u);
+  seen.assign(rows * width, 0u);
+  epoch = 0;
+}
+
+template <class F>
+auto Frontier::each_around(std::size_t i, F&& f) const noexcept -> void {
+  const auto x = static_cast<std::ptrdiff_t>(i % width);
+  const auto y = static_cast<std::ptrdiff_t>(i / width % height);
+  const auto z = static_cast<std::ptrdiff_t>(i / width / height);
+  for (const auto& [dx, dy, dz] : around) {
+    const auto nx = x + dx;
+    const auto ny = y + dy;
+    const auto nz = z + dz;
+    if (nx < 0 or ny < 0 or nz < 0) continue;
+    if (static_cast<std::size_t>(nx) >= width or static_cast<std::size_t>(ny) >= height or static_cast<std::size_t>(nz) >= depth) continue;
+    f((static_cast<std::size_t>(nz) * height + static_cast<std::size_t>(ny)) * width + static_cast<std::size_t>(nx));
+  }
+}
+
+auto Frontier::spread(std::size_t r) noexcept -> void {
+  const auto* row = stdr::data(current) + r * row_words;
+  for (auto w = 0uz; w < row_words; ++w) {
+    const auto lo = w > 0u             ? row[w - 1u] : Word{ 0 };
+    const auto hi = w + 1u < row_words ? row[w + 1u] : Word{ 0 };
+    spread_row[w] = row[w]
+                  | (row[w] << 1u) | (lo >> (WORD_BITS - 1u))
+                  | (row[w] >> 1u) | (hi << (WORD_BITS - 1u));
+  }
+}
+
+auto Frontier::operator()(
+  const Grid<symbol>& grid,
+  const charset& zero,
+  const charset& substrate,
+  std::vector<stk::u32>& distances
+) noexcept -> void {
+  layout(grid.extents);
+
+  distances.assign(stdr::size(grid.values), UNREACHED);
+  stdr::fill(open, Word{ 0 });
+  stdr::fill(current, Word{ 0 });
+  current_rows.clear();
+
+  const auto rows = depth * height;
+  for (auto r = 0uz; r < rows; ++r) {
+    auto any = Word{ 0 };
+    for (auto x = 0uz, i = r * width; x < width; ++x, ++i) {
+      const auto bit = Word{ 1 } << (x % WORD_BITS);
+      const auto w   = r * row_words + x / WORD_BITS;
+      if (zero.contains(grid.values[i])) {
+        current[w] |= bit;
+        any        |= bit;
+        distances[i] = 0u;
+      }
+      else if (substrate.contains(grid.values[i])) {
+        open[w] |= bit;
+      }
+    }
+    if (any != 0u) current_rows.push_back(static_cast<stk::u32>(r));
+  }
+
+  for (auto d = stk::u32{ 1 }; not stdr::empty(current_rows); ++d) {
+    next_rows.clear();
+
+    /* the next level is the current one grown by a cell in every direction, kept to the cells still open */
+    for (auto r : current_rows) {
+      spread(r);
+
+      const auto y = static_cast<std::ptrdiff_t>(r % height);
+      const auto z = static_cast<std::ptrdiff_t>(r / height);
+      for (const auto& [dy, dz] : neighbours) {
+        const auto ny = y + dy;
+        const auto nz = z + dz;
+        if (ny < 0 or nz < 0) continue;
+        if (static_cast<std::size_t>(ny) >= height or static_cast<std::size_t>(nz) >= depth) continue;
+
+        const auto nr = static_cast<std::size_t>(nz) * height + static_cast<std::size_t>(ny);
+        auto any = Word{ 0 };
+        for (auto w = 0uz; w < row_words; ++w) {
+          const auto bits = spread_row[w] & open[nr * row_words + w];
+          next[nr * row_words + w] |= bits;
+          any |= bits;
+        }
+        if (any != 0u and listed[nr] == 0u) {
+          listed[nr] = 1u;
+          next_rows.push_back(static_cast<stk::u32>(nr));
+        }
+      }
+    }
+
+    for (auto r : current_rows) {
+      stdr::fill_n(stdr::begin(current) + static_cast<std::ptrdiff_t>(r * row_words), static_cast<std::ptrdiff_t>(row_words), Word{ 0 });
+    }
+
+    for (auto r : next_rows) {
+      listed[r] = 0u;
+      for (auto w = 0uz; w < row_words; ++w) {
+        const auto bits = next[r * row_words + w];
+        open[r * row_words + w] &= ~bits;
+        for (auto b = bits; b != 0u; b &= b - 1u) {
+          distances[r * width + w * WORD_BITS + static_cast<std::size_t>(std::countr_zero(b))] = d;
+        }
+      }
+    }
+
+    std::swap(current, next);
+    std::swap(current_rows, next_rows);
+  }
+}
+
+auto Frontier::update(
+  const Grid<symbol>& grid,
+  const charset& zero,
+  const charset& substrate,
+  std::span<const Change<symbol>> changes,
+  std::vector<stk::u32>& distances,
+  std::size_t& reached
+) noexcept -> bool {
+  layout(grid.extents);
+  touched.clear();
+
+  const auto cells = stdr::size(grid.values);
+  if (stdr::size(distances) != cells) return false;
+  if (stdr::size(changes) * REPAIR_SHARE > cells) return false;
+
+  const auto source = [&grid, &zero](std::size_t i) noexcept {
+    return zero.contains(grid.values[i]);
+  };
+  const auto open = [&grid, &zero, &substrate](std::size_t i) noexcept {
+    return not zero.contains(grid.values[i]) and substrate.contains(grid.values[i]);
+  };
+  const auto set = [this, &distances, &reached](std::size_t i, stk::u32 d) noexcept {
+    if (distances[i] == UNREACHED and d != UNREACHED) reached++;
+    if (distances[i] != UNREACHED and d == UNREACHED) reached--;
+    distances[i] = d;
+    touched.push_back(static_cast<stk::u32>(i));
+  };
+  const auto push = [this](stk::u32 d, std::size_t i) noexcept {
+    queue.emplace_back(d, static_cast<stk::u32>(i));
+    stdr::push_heap(queue, std::greater{});
+  };
+  const auto pop = [this]() noexcept {
+    stdr::pop_heap(queue, std::greater{});
+    const auto front = queue.back();
+    queue.pop_back();
+    return front;
+  };
+
+  if (++epoch == 0) {
+    stdr::fill(seen, 0u);
+    epoch = 1;
+  }
+  dirty.clear();
+  invalid.clear();
+  queue.clear();
+
+  /* a cell keeps its distance while a neighbour one step closer keeps its own, which is decided first */
+  for (const auto& change : changes) {
+    const auto i = static_cast<std::size_t>(toIndex(change.u, grid.extents));
+    if (seen[i] == epoch) continue;
+    seen[i] = epoch;
+    dirty.push_back(static_cast<stk::u32>(i));
+    if (distances[i] != UNREACHED and not source(i)) push(distances[i], i);
+  }
+
+  while (not stdr::empty(queue)) {
+    const auto [d, i] = pop();
+    if (distances[i] != d) continue;
+
+    auto supported = false;
+    if (d > 0u and open(i)) {
+      each_around(i, [&distances, &supported, d](std::size_t n) noexcept {
+        supported |= distances[n] == d - 1u;
+      });
+    }
+    if (supported) continue;
+
+    set(i, UNREACHED);
+    invalid.push_back(i);
+    if (stdr::size(invalid) * REPAIR_SHARE > cells) return false;
+
+    each_around(i, [&distances, &source, &push, d](std::size_t n) noexcept {
+      if (distances[n] == d + 1u and not source(n)) push(d + 1u, n);
+    });
+  }
+
+  /* invalidated and changed cells restart from their closest neighbour, new zero cells from themselves */
+  const auto seed = [this, &distances, &open, &set, &push](std::size_t i) noexcept {
+    if (not open(i)) return;
+    auto best = UNREACHED;
+    each_around(i, [&distances, &best](std::size_t n) noexcept {
+      if (distances[n] != UNREACHED) best = std::min(best, distances[n] + 1u);
+    });
+    if (best < distances[i]) {
+      set(i, best);
+      push(best, i);
+    }
+  };
+
+  for (auto i : dirty) {
+    if (not source(i)) seed(i);
+    else if (distances[i] != 0u) {
+      set(i, 0u);
+      push(0u, i);
+    }
+  }
+  for (auto i : invalid) seed(i);
+
+  while (not stdr::empty(queue)) {
+    const auto [d, i] = pop();
+    if (distances[i] != d) continue;
+
+    each_around(i, [&distances, &open, &set, &push, d](std::size_t n) noexcept {
+      if (open(n) and distances[n] > d + 1u) {
+        set(n, d + 1u);
+        push(d + 1u, n);
+      }
+    });
+  }
+
+  return true;
+}
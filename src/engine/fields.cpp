@@ -1,63 +1,142 @@
 module engine.fields;
 
 import stormkit.core;
-import geometry;
+import engine.distance;
+import workers;
 
-// namespace stk  = stormkit;
+namespace stk  = stormkit;
 namespace stdr = std::ranges;
 namespace stdv = std::views;
 
-auto Field::potential(const Grid<char>& grid, Potential& potential) const noexcept -> void {
-  propagate(
-    mdiota(potential.area())
-      | stdv::filter([this, &grid](auto u) noexcept {
-          return zero.contains(grid[u]);
-      })
-      | stdv::transform([&potential](auto u) noexcept {
-          potential[u] = 0.0;
-          return std::tuple{ u, 0.0 };
-      }),
-    [this, &grid, &potential](auto&& front) noexcept {
-      static constexpr auto neigh_size = 3ul * Area3::Size{ 1, 1, 1 };
-      static constexpr auto neigh_shift = -static_cast<Area3::Offset>(neigh_size) / 2l;
-      static constexpr auto neigh = Area3{ neigh_shift, neigh_size };
-
-      auto [u, p] = front;
-      auto new_us = (neigh + u).meet(potential.area());
-      auto new_p  = inversed ? p - 1.0 : p + 1.0;
-      return mdiota(new_us)
-        | stdv::filter([this, &grid, &potential](auto n) noexcept {
-            return not is_normal(potential[n])
-               and substrate.contains(grid[n]);
-        })
-        | stdv::transform([&potential, new_p](auto n) noexcept {
-            potential[n] = new_p;
-            return std::tuple{ n, new_p };
-        });
-    }
-  );
+/** The frontier keeps its bitsets and queues between calls, one per thread */
+static auto frontier() noexcept -> Frontier& {
+  thread_local auto frontier = Frontier{};
+  return frontier;
 }
 
-auto Field::potentials(const Fields& fields, const Grid<char>& grid, Potentials& potentials) noexcept -> void {
-  for (auto& [c, f] : fields) {
-    if (potentials.contains(c) and not f.recompute) {
-      continue;
-    }
+static_assert(Frontier::UNREACHED == Potentials::UNSET);
 
-    if (potentials.contains(c)) {
-      stdr::fill(potentials.at(c).values, std::numeric_limits<double>::quiet_NaN());
-      // stdr::fill(potentials.at(c), std::numeric_limits<double>::quiet_NaN());
-    }
-    else {
-      potentials.emplace(c, Potential{ grid.extents, std::numeric_limits<double>::quiet_NaN() });
+/** Grids from which the fields of a node are computed on the workers */
+static constexpr auto PARALLEL_CELLS = 1uz << 14;
+
+auto Field::compute(const Grid<symbol>& grid, Distances& distances) const noexcept -> void {
+  frontier()(grid, zero, substrate, distances.values);
+  distances.reached = static_cast<std::size_t>(stdr::count_if(distances.values, [](auto d) static noexcept {
+    return d != Frontier::UNREACHED;
+  }));
+}
+
+auto Field::repair(const Grid<symbol>& grid, std::span<const Change<symbol>> changes, Distances& distances) const noexcept -> bool {
+  auto& f = frontier();
+  if (not f.update(grid, zero, substrate, changes, distances.values, distances.reached)) return false;
+
+  /* the frontier is shared by the fields of the thread, its scratch goes back to it */
+  std::swap(distances.touched, f.touched);
+  return true;
+}
+
+auto Field::refresh(const TracedGrid<symbol>& grid, Shared& shared) const noexcept -> void {
+  auto& distances = shared.distances;
+  auto& start     = shared.start;
+  const auto h    = stdr::size(grid.history());
+  const auto same = shared.generation == grid.generation();
+
+  if (same and distances.prev <= h) {
+    if (distances.prev == h) return;
+
+    if (repair(grid, grid.history().subspan(distances.prev), distances)) {
+      distances.prev  = h;
+      shared.repaired = true;
+      shared.version++;
+      return;
     }
+    compute(grid, distances);
+  }
+  /* a run starting over from the grid the last one started from, as after a reset, takes back the distances of that start */
+  else if (not same and start.extents == grid.extents() and start.grid == grid.values()) {
+    distances.values  = start.values;
+    distances.reached = start.reached;
+  }
+  else {
+    compute(grid, distances);
+    if (not same) start = { grid.extents(), grid.values(), distances.values, distances.reached };
+  }
 
-    f.potential(grid, potentials.at(c));
+  shared.generation = grid.generation();
+  distances.prev    = h;
+  shared.repaired   = false;
+  shared.version++;
+}
+
+auto Field::potentials(const Fields& fields, const TracedGrid<symbol>& grid, Potentials& potentials, Cache& cache, Store& store) noexcept -> void {
+  struct Job {
+    symbol       c;
+    const Field* field;
+    Written*     written;
+    /** First job of its shared distances, the one bringing them up to date */
+    bool         first = false;
+  };
+
+  auto jobs = fields
+    | stdv::filter([&potentials](const auto& cf) noexcept {
+        const auto& [c, f] = cf;
+        return not potentials.contains(c) or f.recompute;
+    })
+    | stdv::transform([&cache, &store](const auto& cf) noexcept {
+        const auto& [c, f] = cf;
+        auto& written = cache[c];
+        if (not written.shared) {
+          auto& shared = store[{ f.substrate.words, f.zero.words }];
+          if (not shared) shared = std::make_shared<Shared>();
+          written.shared = shared;
+        }
+        return Job{ c, &f, &written };
+    })
+    | stdr::to<std::vector>();
+
+  for (auto k = 0uz; k < stdr::size(jobs); ++k) {
+    jobs[k].first = stdr::none_of(jobs | stdv::take(static_cast<std::ptrdiff_t>(k)), [&jobs, k](const auto& job) noexcept {
+      return job.written->shared == jobs[k].written->shared;
+    });
+  }
+
+  /* a job only reads the grid and writes its own shared distances */
+  const auto run = [&jobs, &grid](std::size_t k) noexcept {
+    const auto& [c, field, written, first] = jobs[k];
+    if (first) field->refresh(grid, *written->shared);
+  };
 
-    if (stdr::none_of(potentials.at(c), is_normal)) {
-      potentials.erase(potentials.find(c));
+  if (stdr::size(jobs) > 1u and stdr::size(grid.values()) >= PARALLEL_CELLS) {
+    Workers::shared().parallel_for(stdr::size(jobs), run);
+  }
+  else {
+    for (auto k = 0uz; k < stdr::size(jobs); ++k) run(k);
+  }
+
+  for (const auto& [c, field, written, _] : jobs) {
+    const auto& shared    = *written->shared;
+    const auto& distances = shared.distances;
+
+    /* an empty field stops the pass, the fields after it keeping their former potentials */
+    if (distances.reached == 0u) {
+      potentials.erase(c);
+      cache.erase(c);
       break;
     }
+
+    if (not potentials.contains(c)) {
+      potentials.emplace(c, grid.extents(), field->inversed);
+      written->version = 0;
+    }
+
+    /* the plane follows the shared distances, wholly unless it only misses their last repair */
+    if (written->version + 1u == shared.version and shared.repaired) {
+      for (auto i : distances.touched) potentials.set(c, i, distances.values[i]);
+    }
+    else if (written->version != shared.version) {
+      for (auto [i, d] : stdv::enumerate(distances.values)) potentials.set(c, static_cast<std::size_t>(i), d);
+    }
+    written->version = shared.version;
   }
 }
 
@@ -0,0 +1,146 @@
+module engine.interpreter;
+
+namespace stdr = std::ranges;
+namespace stdv = std::views;
+
+Interpreter::Interpreter(NodeRunner& _program, TracedGrid<symbol>& _grid) noexcept
+: program{&_program},
+  grid{&_grid}
+{
+  compile(*program);
+}
+
+/** Lays the subtree out in preorder, the children of a tree being contiguous in `children` */
+auto Interpreter::compile(NodeRunner& node) noexcept -> stk::u32 {
+  const auto index = static_cast<stk::u32>(stdr::size(instructions));
+  instructions.emplace_back();
+
+  if (auto p = std::get_if<RuleRunner>(&node); p != nullptr) {
+    instructions[index].rule = p;
+    return index;
+  }
+
+  auto& tree  = std::get<TreeRunner>(node);
+  auto  nodes = tree.nodes
+    | stdv::transform([this](auto& n) noexcept { return compile(n); })
+    | stdr::to<std::vector>();
+
+  instructions[index] = {
+    .tree  = &tree,
+    .first = static_cast<stk::u32>(stdr::size(children)),
+    .count = static_cast<stk::u32>(stdr::size(nodes)),
+  };
+  children.append_range(nodes);
+  return index;
+}
+
+auto Interpreter::enter(stk::u32 instruction) noexcept -> void {
+  auto& tree = *instructions[instruction].tree;
+  tree.current_node = stdr::begin(tree.nodes);
+  frames.push_back({ .instruction = instruction });
+}
+
+auto Interpreter::apply(RuleRunner& rule) noexcept -> bool {
+  if (rule.steps > 0 and rule.step >= rule.steps) return false;
+  if (not rule.rulenode.viable(*grid)) return false;
+
+  changes.clear();
+  rule.rulenode(*grid, changes);
+  if (stdr::empty(changes)) return false;
+
+  stdr::for_each(changes, std::bind_front(&TracedGrid<symbol>::apply, grid));
+  rule.step++;
+  return true;
+}
+
+auto Interpreter::step() noexcept -> bool {
+  if (is_halted) return false;
+
+  if (not started) {
+    started = true;
+
+    /* a lone rule applies once, as its generator would */
+    if (const auto& root = instructions.front(); root.rule != nullptr) {
+      is_halted = true;
+      return apply(*root.rule);
+    }
+    enter(0u);
+  }
+
+  while (not stdr::empty(frames)) {
+    auto& frame = frames.back();
+    const auto& instruction = instructions[frame.instruction];
+    auto& tree = *instruction.tree;
+
+    if (frame.done) {
+      if (not frame.found) frame.child++;
+      else if (tree.mode == TreeRunner::Mode::MARKOV) frame.child = 0u;
+
+      frame.found = frame.done = false;
+      tree.current_node = stdr::next(stdr::begin(tree.nodes), frame.child);
+    }
+
+    if (frame.child == instruction.count) {
+      stdr::for_each(tree.nodes, ::reset);
+
+      const auto yielded = frame.yielded;
+      frames.pop_back();
+      if (not stdr::empty(frames)) {
+        auto& parent = frames.back();
+        parent.found   |= yielded;
+        parent.yielded |= yielded;
+        parent.done     = true;
+      }
+      continue;
+    }
+
+    const auto next = children[instruction.first + frame.child];
+    frame.done = true;
+
+    if (instructions[next].tree != nullptr) {
+      enter(next);
+      continue;
+    }
+
+    if (apply(*instructions[next].rule)) {
+      frame.found = frame.yielded = true;
+      return true;
+    }
+  }
+
+  is_halted = true;
+  return false;
+}
+
+auto Interpreter::run(std::size_t n) noexcept -> Progress {
+  auto progress = Progress{};
+  while (progress.steps < n and step()) progress.steps++;
+  progress.halted = is_halted;
+  return progress;
+}
+
+auto Interpreter::run_for(clock::duration budget) noexcept -> Progress {
+  const auto deadline = clock::now() + budget;
+
+  auto progress = Progress{};
+  while (step()) {
+    progress.steps++;
+    if (clock::now() >= deadline) break;
+  }
+  progress.halted = is_halted;
+  return progress;
+}
+
+auto Interpreter::run_until_halt() noexcept -> Progress {
+  return run(std::numeric_limits<std::size_t>::max());
+}
+
+auto Interpreter::reset() noexcept -> void {
+  ::reset(*program);
+  frames.clear();
+  started = is_halted = false;
+}
+
+auto Interpreter::steps() noexcept -> std::generator<bool> {
+  while (step()) co_yield true;
+}
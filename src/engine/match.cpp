@@ -1,47 +1,139 @@
 module engine.match;
 
 import log;
+import engine.bitplanes;
 
 namespace stdr = std::ranges;
 namespace stdv = std::views;
 
 auto Match::scan(
-  const Grid<char>& grid,
+  const Grid<symbol>& grid,
+  std::span<const RewriteRule> rules
+) noexcept -> std::vector<Match> {
+  if (stdr::size(grid.values) < BitPlanes::WORD_BITS) {
+    return scan_lattice(grid, rules);
+  }
+
+  return BitPlanes{ grid }.scan(rules);
+}
+
+auto dirty_boxes(std::span<const Change<symbol>> history) noexcept -> std::vector<Area3> {
+  const auto volume = [](const Area3& a) static noexcept {
+    return a.size.x * a.size.y * a.size.z;
+  };
+
+  auto boxes  = std::vector<Area3>{};
+  auto counts = std::vector<std::size_t>{};
+  for (const auto& change : history) {
+    auto cell = Area3{ change.u, { 1u, 1u, 1u } };
+    if (not stdr::empty(boxes)) {
+      if (auto joined = boxes.back().join(cell);
+               volume(joined) <= 2u * (counts.back() + 1u)
+      ) {
+        boxes.back() = joined;
+        ++counts.back();
+        continue;
+      }
+    }
+    boxes.push_back(cell);
+    counts.push_back(1u);
+  }
+  return boxes;
+}
+
+auto Match::scan(
+  const Grid<symbol>& grid,
   std::span<const RewriteRule> rules,
-  std::span<const Change<char>> history
+  std::span<const Change<symbol>> history,
+  Stamps& anchors
 ) noexcept -> std::vector<Match> {
-  if (not stdr::empty(history)) {
-    return {
-      std::from_range,
-      stdv::zip(rules, stdv::iota(0u))
-        | stdv::transform([&grid, &history](const auto& v) noexcept {
-            const auto& [rule, r] = v;
-            return history
-              | stdv::transform(&Change<char>::u)
-              // TODO group changes according to rule size
-              // currently this is highly redundant on adjacent changes (which happens a lot..)
-              | stdv::transform([&grid, &rule](auto u) noexcept {
-                  return rule.get_ishifts(grid[u])
-                    | stdv::transform(std::bind_front(std::minus<Area3::Offset>{}, u))
-                    | stdv::filter([g_area = grid.area(), r_area = rule.input.area()](auto u) noexcept {
-                        auto ru_area = r_area + u;
-                        return g_area.meet(ru_area) == ru_area;
-                    });
-              })
-              | stdv::join
-              | stdr::to<std::unordered_set>()
-              | stdv::transform([r](auto u) noexcept {
-                  return std::tuple{ u, r };
-              });
-        })
-        | stdv::join
-        | stdv::transform([rules](auto&& ur) noexcept {
-            return Match{ rules, std::get<0>(ur), std::get<1>(ur) };
-        })
-        | stdv::filter(std::bind_back(&Match::match, std::cref(grid)))
-    };
+  auto matches = std::vector<Match>{};
+
+  const auto boxes  = dirty_boxes(history);
+  const auto g_size = fromExtents(grid.extents);
+
+  for (auto r = 0uz; r < stdr::size(rules); ++r) {
+    const auto& rule = rules[r];
+    const auto r_size = rule.input.area().size;
+    if (glm::any(glm::greaterThan(r_size, g_size))) continue;
+
+    const auto neighborhood = rule.backward_neighborhood();
+    const auto valid = Area3{ {}, g_size - r_size + Area3::Size{ 1u, 1u, 1u } };
+
+    anchors.reset(grid.extents);
+    for (const auto& box : boxes) {
+      /* anchors from which the rule input reaches into the box */
+      auto dilated = Area3{ box.u + neighborhood.u, box.size + neighborhood.size - Area3::Size{ 1u, 1u, 1u } };
+      for (auto u : mdiota(valid.meet(dilated))) {
+        if (not anchors.mark(u)) continue;
+        if (auto match = Match{ rules, u, static_cast<stk::ioffset>(r) };
+                 match.match(grid)
+        ) {
+          matches.push_back(match);
+        }
+      }
+    }
+  }
+
+  return matches;
+}
+
+auto Match::scan_anchored(
+  const Grid<symbol>& grid,
+  const Occurrences& occurrences,
+  std::span<const RewriteRule> rules
+) noexcept -> std::optional<std::vector<Match>> {
+  const auto g_size = fromExtents(grid.extents);
+  const auto budget = stdr::size(grid.values) / RARE_RATIO;
+
+  /* the input cell of each rule holding the fewest candidates */
+  auto leads = std::vector<std::tuple<Area3::Offset, charset>>{};
+  for (const auto& rule : rules) {
+    auto lead  = std::optional<std::tuple<Area3::Offset, charset>>{};
+    auto least = std::numeric_limits<std::size_t>::max();
+    for (const auto& [u, i] : stdv::zip(mdiota(rule.input.area()), rule.input)) {
+      if (not i) continue;
+      auto count = stdr::fold_left(
+        *i | stdv::transform([&occurrences](auto c) noexcept { return occurrences.count(c); }),
+        0uz, std::plus{}
+      );
+      if (count < least) {
+        least = count;
+        lead  = std::tuple{ u, *i };
+      }
+    }
+    if (not lead or least > budget) return std::nullopt;
+    leads.push_back(*lead);
+  }
+
+  auto matches = std::vector<Match>{};
+  for (auto r = 0uz; r < stdr::size(rules); ++r) {
+    const auto r_size = rules[r].input.area().size;
+    if (glm::any(glm::greaterThan(r_size, g_size))) continue;
+
+    const auto valid = Area3{ {}, g_size - r_size + Area3::Size{ 1u, 1u, 1u } };
+    const auto& [o, values] = leads[r];
+    for (auto c : values) {
+      for (auto i : occurrences.of(c)) {
+        /* a cell holds a single symbol, so every anchor is reached once */
+        auto u = fromIndex(i, grid.extents) - o;
+        if (not valid.contains(u)) continue;
+        if (auto match = Match{ rules, u, static_cast<stk::ioffset>(r) };
+                 match.match(grid)
+        ) {
+          matches.push_back(match);
+        }
+      }
+    }
   }
 
+  return matches;
+}
+
+auto Match::scan_lattice(
+  const Grid<symbol>& grid,
+  std::span<const RewriteRule> rules
+) noexcept -> std::vector<Match> {
   return {
     std::from_range,
     stdv::zip(rules, stdv::iota(0u))
@@ -76,23 +168,13 @@ auto Match::scan(
   };
 }
 
-auto Match::match(const Grid<char>& grid) const noexcept -> bool {
-  // return stdr::mismatch(
-  //   rules[r].input, mdiota(area()),
-  //   [](const auto& i, char c) static noexcept {
-  //     return not i or i->contains(c);
-  //   },
-  //   {}, [&grid](auto u) { return grid[u]; }
-  // )
-  //   .in1 == stdr::end(rules[r].input);
-  return stdr::all_of(
-    stdv::zip(mdiota(area()), rules[r].input),
-    [&grid](const auto& input) noexcept {
-      auto [u, i] = input;
-      return not i
-          or i->contains(grid[u]);
-    }
-  );
+auto Match::match(const Grid<symbol>& grid) const noexcept -> bool {
+  const auto& rule = rules[r];
+  if (const auto baked = rule.kernel.baked_match; baked != nullptr) {
+    const auto row = grid.extents.extent(2);
+    return baked(stdr::data(grid.values), row, row * grid.extents.extent(1), static_cast<std::size_t>(toIndex(u, grid.extents)));
+  }
+  return rule.kernel.match(rule.input, grid, u);
 }
 
 auto Match::conflict(const Match& other) const noexcept -> bool {
@@ -105,43 +187,36 @@ auto Match::conflict(const Match& other) const noexcept -> bool {
   );
 }
 
-auto Match::changes(const Grid<char>& grid) const noexcept -> std::vector<Change<char>> {
-  return stdv::zip(mdiota(area()), rules[r].output)
-    | stdv::filter([&grid](const auto& output) noexcept {
-        auto [u, o] = output;
-        return  o
-           and *o != grid[u];
-    })
-    | stdv::transform([](auto&& output) static noexcept {
-        return Change{std::get<0>(output), *std::get<1>(output)};
-    })
-    | stdr::to<std::vector>();
-}
-
-auto Match::delta(const Grid<char>& grid, const Potentials& potentials) const noexcept -> double {
-  return stdr::fold_left(
-    stdv::zip(mdiota(area()), rules[r].output)
-      | stdv::filter([&grid](auto&& _o) noexcept {
-          auto [u, o] = _o;
-          return  o
-             and *o != grid[u];
-      })
-      | stdv::transform([&grid, &potentials] (const auto& _o) noexcept {
-          auto [u, o] = _o;
+auto Match::changes(const Grid<symbol>& grid) const noexcept -> std::vector<Change<symbol>> {
+  auto changes = std::vector<Change<symbol>>{};
+  const auto& rule = rules[r];
+  if (const auto baked = rule.kernel.baked_changes; baked != nullptr) {
+    const auto size = rule.output.area().size;
+    const auto row  = grid.extents.extent(2);
 
-          auto new_value = *o;
-          auto old_value = grid[u];
+    thread_local auto cells  = std::vector<stk::u32>{};
+    thread_local auto writes = std::vector<symbol>{};
+    cells.resize(stdr::size(rule.output.values));
+    writes.resize(stdr::size(rule.output.values));
 
-          auto new_p = potentials.contains(new_value) ? potentials.at(new_value)[u] : 0.0;
-          auto old_p = potentials.contains(old_value) ? potentials.at(old_value)[u] : 0.0;
-
-          if (not is_normal(old_p))
-            old_p = -1.0;
+    const auto n = baked(
+      stdr::data(grid.values), row, row * grid.extents.extent(1), static_cast<std::size_t>(toIndex(u, grid.extents)),
+      stdr::data(cells), stdr::data(writes)
+    );
+    changes.reserve(n);
+    for (auto k = 0uz; k < n; ++k) {
+      const auto c = static_cast<std::size_t>(cells[k]);
+      changes.push_back({ u + Area3::Offset{ c % size.x, c / size.x % size.y, c / size.x / size.y }, writes[k] });
+    }
+    return changes;
+  }
+  rule.kernel.changes(rule.output, grid, u, changes);
+  return changes;
+}
 
-          return new_p - old_p;
-      }),
-    0, std::plus{}
-  );
+auto Match::delta(const Grid<symbol>& grid, const Potentials& potentials) const noexcept -> double {
+  const auto& rule = rules[r];
+  return rule.kernel.delta(rule.output, grid, potentials, u);
 }
 
 auto Match::backward_match(const Potentials& potentials, double p) const noexcept -> bool {
@@ -156,8 +231,7 @@ auto Match::backward_match(const Potentials& potentials, double p) const noexcep
     },
     [&potentials](const auto& output) noexcept {
       auto [u, o] = output;
-      return potentials.contains(*o) ? potentials.at(*o)[u]
-             : std::numeric_limits<double>::quiet_NaN();
+      return potentials.at(*o, u);
     }
   );
 }
@@ -175,30 +249,26 @@ auto Match::forward_match(const Potentials& potentials, double p) const noexcept
     [&potentials](const auto& input) noexcept {
       auto [u, i] = input;
       auto im = stdr::max(*i, {}, [&potentials, u] (auto i) {
-        return potentials.contains(i) ? potentials.at(i)[u]
-          : std::numeric_limits<double>::quiet_NaN();
+        return potentials.at(i, u);
       });
-      return potentials.contains(im) ? potentials.at(im)[u]
-        : std::numeric_limits<double>::quiet_NaN();
+      return potentials.at(im, u);
     }
   );
 }
 
 auto Match::backward_changes(const Potentials& potentials) const noexcept
--> std::vector<Change<char>> {
+-> std::vector<Change<symbol>> {
   return stdv::zip(mdiota(area()), rules[r].input)
     | stdv::filter([&potentials](const auto& input) noexcept {
         auto [u, i] = input;
         return i and stdr::any_of(*i, [&potentials, u](auto i) noexcept {
-          return not potentials.contains(i)
-             or not is_normal(potentials.at(i)[u]);
+          return not is_normal(potentials.at(i, u));
         });
     })
     | stdv::transform([&potentials](auto&& input) noexcept {
         auto [u, i] = input;
         auto im = *i | stdv::filter([&potentials, u] (auto i) noexcept {
-          return not potentials.contains(i)
-             or not is_normal(potentials.at(i)[u]);
+          return not is_normal(potentials.at(i, u));
         }) | stdr::to<std::vector>();
         return Change{ u, im[0] };
     })
@@ -206,12 +276,12 @@ auto Match::backward_changes(const Potentials& potentials) const noexcept
 }
 
 auto Match::forward_changes(const Potentials& potentials) const noexcept
--> std::vector<Change<char>> {
+-> std::vector<Change<symbol>> {
   return stdv::zip(mdiota(area()), rules[r].output)
     | stdv::filter([&potentials](const auto& output) noexcept {
         auto [u, o] = output;
         return o
-           and is_normal(potentials.at(*o)[u]);
+           and is_normal(potentials.at(*o, u));
     })
     | stdv::transform([](auto&& output) noexcept {
         return Change{ std::get<0>(output), *std::get<1>(output) };
@@ -0,0 +1,204 @@
+module engine.matcher;
+
+import workers;
+
+namespace stdr = std::ranges;
+namespace stdv = std::views;
+
+auto Matcher::compile(std::span<const RewriteRule> rules) noexcept -> std::optional<Matcher> {
+  if (stdr::size(rules) < MIN_RULES) return std::nullopt;
+
+  auto matcher = Matcher{};
+
+  /* symbols accepted by exactly the same inputs can't be told apart by any probe */
+  auto sets = std::vector<charset>{};
+  for (const auto& i : rules | stdv::transform(&RewriteRule::input) | stdv::join) {
+    if (i and stdr::find(sets, *i) == stdr::end(sets)) sets.push_back(*i);
+  }
+
+  auto signatures = std::map<std::vector<bool>, stk::u16>{};
+  auto members    = std::vector<symbol>{};
+  for (auto s = 0uz; s < charset::CAPACITY; ++s) {
+    auto signature = sets
+      | stdv::transform([s](const auto& set) noexcept { return set.contains(static_cast<symbol>(s)); })
+      | stdr::to<std::vector<bool>>();
+    auto [it, added] = signatures.try_emplace(std::move(signature), static_cast<stk::u16>(stdr::size(signatures)));
+    if (added) members.push_back(static_cast<symbol>(s));
+    matcher.classes[s] = it->second;
+  }
+  const auto out = stdr::size(members);
+  matcher.width  = out + 1u;
+
+  /* one condition per constrained cell, plus the far corner of the input so that anchors keep it inside the grid */
+  struct Condition {
+    stk::u32          r;
+    Area3::Offset     u;
+    std::vector<bool> accepts;
+  };
+  auto conditions = std::vector<Condition>{};
+  for (auto r = 0uz; r < stdr::size(rules); ++r) {
+    const auto& input = rules[r].input;
+    matcher.reach = glm::max(matcher.reach, input.area().size);
+
+    for (const auto& [u, i] : stdv::zip(mdiota(input.area()), input)) {
+      if (not i) continue;
+      auto accepts = members
+        | stdv::transform([&i](auto s) noexcept { return i->contains(s); })
+        | stdr::to<std::vector<bool>>();
+      accepts.push_back(false);
+      conditions.push_back({ static_cast<stk::u32>(r), u, std::move(accepts) });
+    }
+
+    if (auto corner = input.area().shiftmax(); not input[corner]) {
+      auto accepts = std::vector<bool>(matcher.width, true);
+      accepts.back() = false;
+      conditions.push_back({ static_cast<stk::u32>(r), corner, std::move(accepts) });
+    }
+  }
+
+  /* a node is identified by the rules it accepts and the conditions left to check */
+  using State = std::tuple<std::vector<stk::u32>, std::vector<stk::u32>>;
+  auto memo  = std::map<State, stk::u32>{};
+  auto queue = std::deque<State>{};
+
+  const auto intern = [&memo, &queue](State state) noexcept -> stk::u32 {
+    const auto& [accepted, remaining] = state;
+    if (stdr::empty(accepted) and stdr::empty(remaining)) return 0u;
+
+    auto [it, added] = memo.try_emplace(state, static_cast<stk::u32>(stdr::size(memo) + 1u));
+    if (added) queue.push_back(std::move(state));
+    return it->second;
+  };
+
+  /* node 0 is the dead end, accepting nothing and probing nothing */
+  matcher.probes.push_back(std::nullopt);
+  matcher.next.append_range(stdv::repeat(0u, matcher.width));
+  matcher.starts = { 0u, 0u };
+
+  matcher.root = intern({ std::vector<stk::u32>{}, stdv::iota(0u, static_cast<stk::u32>(stdr::size(conditions))) | stdr::to<std::vector>() });
+
+  for (; not stdr::empty(queue); queue.pop_front()) {
+    if (stdr::size(memo) > MAX_NODES) return std::nullopt;
+
+    const auto& [accepted, remaining] = queue.front();
+
+    matcher.accepted.append_range(accepted);
+    matcher.starts.push_back(static_cast<stk::u32>(stdr::size(matcher.accepted)));
+
+    if (stdr::empty(remaining)) {
+      matcher.probes.push_back(std::nullopt);
+      matcher.next.append_range(stdv::repeat(0u, matcher.width));
+      continue;
+    }
+
+    /* probe the cell constrained by the most rules */
+    auto counts = std::map<std::tuple<stk::ioffset, stk::ioffset, stk::ioffset>, std::size_t>{};
+    for (auto c : remaining) {
+      const auto& u = conditions[c].u;
+      ++counts[{ u.z, u.y, u.x }];
+    }
+    const auto [z, y, x] = stdr::max_element(counts, {}, stk::monadic::get<1>())->first;
+    const auto probe = Area3::Offset{ x, y, z };
+    matcher.probes.push_back(probe);
+
+    for (auto k = 0uz; k < matcher.width; ++k) {
+      auto rejected = remaining
+        | stdv::filter([&conditions, probe, k](auto c) noexcept {
+            return conditions[c].u == probe and not conditions[c].accepts[k];
+        })
+        | stdv::transform([&conditions](auto c) noexcept { return conditions[c].r; })
+        | stdr::to<std::vector>();
+
+      auto left = remaining
+        | stdv::filter([&conditions, &rejected, probe](auto c) noexcept {
+            return conditions[c].u != probe
+               and stdr::find(rejected, conditions[c].r) == stdr::end(rejected);
+        })
+        | stdr::to<std::vector>();
+
+      auto done = remaining
+        | stdv::filter([&conditions, &left, probe, k](auto c) noexcept {
+            return conditions[c].u == probe
+               and conditions[c].accepts[k]
+               and stdr::none_of(left, [&conditions, r = conditions[c].r](auto l) noexcept {
+                     return conditions[l].r == r;
+                   });
+        })
+        | stdv::transform([&conditions](auto c) noexcept { return conditions[c].r; })
+        | stdr::to<std::vector>();
+
+      matcher.next.push_back(intern({ std::move(done), std::move(left) }));
+    }
+  }
+
+  return matcher;
+}
+
+auto Matcher::walk(
+  const Grid<symbol>& grid,
+  std::span<const RewriteRule> rules,
+  Area3::Offset u,
+  std::vector<Match>& matches
+) const noexcept -> void {
+  const auto bound = static_cast<Area3::Offset>(fromExtents(grid.extents));
+  const auto out   = static_cast<stk::u32>(width - 1u);
+
+  for (auto node = root;;) {
+    for (auto i = starts[node]; i < starts[node + 1u]; ++i) {
+      matches.push_back(Match{ rules, u, static_cast<stk::ioffset>(accepted[i]) });
+    }
+
+    const auto& probe = probes[node];
+    if (not probe) return;
+
+    auto v = u + *probe;
+    auto k = glm::all(glm::lessThan(v, bound)) ? stk::u32{ classes[grid[v]] } : out;
+    node = next[node * width + k];
+  }
+}
+
+auto Matcher::scan(const Grid<symbol>& grid, std::span<const RewriteRule> rules) const noexcept -> std::vector<Match> {
+  const auto g_size = fromExtents(grid.extents);
+  const auto rows   = g_size.y * g_size.z;
+
+  auto found = std::vector<std::vector<Match>>(rows);
+  const auto task = [this, &grid, rules, &found, g_size](std::size_t row) noexcept {
+    const auto y = static_cast<stk::ioffset>(row % g_size.y);
+    const auto z = static_cast<stk::ioffset>(row / g_size.y);
+    for (auto x = stk::ioffset{ 0 }; x < static_cast<stk::ioffset>(g_size.x); ++x) {
+      walk(grid, rules, { x, y, z }, found[row]);
+    }
+  };
+
+  if (stdr::size(grid.values) < PARALLEL_CELLS) {
+    for (auto row = 0uz; row < rows; ++row) task(row);
+  }
+  else {
+    Workers::shared().parallel_for(rows, task);
+  }
+
+  return std::move(found)
+    | stdv::join
+    | stdr::to<std::vector>();
+}
+
+auto Matcher::scan(
+  const Grid<symbol>& grid,
+  std::span<const RewriteRule> rules,
+  std::span<const Area3> boxes,
+  Stamps& anchors
+) const noexcept -> std::vector<Match> {
+  auto matches = std::vector<Match>{};
+
+  const auto spread = reach - Area3::Size{ 1u, 1u, 1u };
+
+  anchors.reset(grid.extents);
+  for (const auto& box : boxes) {
+    auto dilated = Area3{ box.u - static_cast<Area3::Offset>(spread), box.size + spread };
+    for (auto u : mdiota(grid.area().meet(dilated))) {
+      if (anchors.mark(u)) walk(grid, rules, u, matches);
+    }
+  }
+
+  return matches;
+}
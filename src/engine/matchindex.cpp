@@ -0,0 +1,190 @@
+module engine.matchindex;
+
+namespace stdr = std::ranges;
+namespace stdv = std::views;
+
+auto MatchIndex::key(const Match& match) const noexcept -> std::size_t {
+  const auto cells = extents.extent(0) * extents.extent(1) * extents.extent(2);
+  return static_cast<std::size_t>(rows[match.r]) * cells
+       + static_cast<std::size_t>(toIndex(match.u, extents));
+}
+
+auto MatchIndex::slot(std::size_t key) const noexcept -> stk::u32 {
+  if (dense) return slots[key];
+  const auto it = sparse.find(key);
+  return it != stdr::end(sparse) ? it->second : NONE;
+}
+
+auto MatchIndex::assign(std::size_t key, stk::u32 position) noexcept -> void {
+  if (dense)                 slots[key] = position;
+  else if (position == NONE) sparse.erase(key);
+  else                       sparse.insert_or_assign(key, position);
+}
+
+auto MatchIndex::rebuild(const TracedGrid<symbol>& grid, std::span<const RewriteRule> rules) noexcept -> void {
+  if (not compiled) {
+    matcher  = Matcher::compile(rules);
+    compiled = true;
+  }
+
+  extents    = grid.extents();
+  generation = grid.generation();
+  matches.clear();
+  weights.clear();
+
+  /* at most 2^24 dense slots, 64 MiB, whatever the number of rules and the size of the grid */
+  const auto g_size = fromExtents(extents);
+  auto fitting = stk::u32{ 0 };
+  rows.assign(stdr::size(rules), NONE);
+  for (auto r = 0uz; r < stdr::size(rules); ++r) {
+    if (not glm::any(glm::greaterThan(rules[r].input.area().size, g_size))) rows[r] = fitting++;
+  }
+
+  const auto count = static_cast<std::size_t>(fitting) * stdr::size(grid.values());
+  dense = count <= DENSE_SLOTS;
+  slots.assign(dense ? count : 0uz, NONE);
+  sparse.clear();
+
+  /* growth fronts are best found from the few cells holding them */
+  auto found = Match::scan_anchored(grid, grid.occurrences(), rules);
+  if (not found) {
+    found = matcher ? matcher->scan(grid, rules) : Match::scan(grid, rules);
+  }
+
+  for (const auto& match : *found) {
+    insert(match);
+  }
+}
+
+auto MatchIndex::update(
+  const TracedGrid<symbol>& grid,
+  std::span<const RewriteRule> rules,
+  std::span<const Change<symbol>> history
+) noexcept -> void {
+  if (stdr::empty(rows) or extents != grid.extents() or generation != grid.generation()) {
+    rebuild(grid, rules);
+    return;
+  }
+  if (stdr::empty(history)) return;
+
+  const auto g_size = fromExtents(extents);
+  const auto cells  = stdr::size(grid.values());
+
+  for (const auto& change : history) {
+    for (auto r = 0uz; r < stdr::size(rules); ++r) {
+      if (rows[r] == NONE) continue;
+      const auto r_size = rules[r].input.area().size;
+
+      /* anchors whose input area covers the changed cell, clipped to the valid anchors */
+      auto first = glm::max(change.u - static_cast<Area3::Offset>(r_size) + Area3::Offset{ 1, 1, 1 }, Area3::Offset{ 0 });
+      auto last  = glm::min(change.u, static_cast<Area3::Offset>(g_size - r_size));
+
+      for (auto u : mdiota({ first, static_cast<Area3::Size>(last - first + Area3::Offset{ 1, 1, 1 }) })) {
+        auto position = slot(rows[r] * cells + static_cast<std::size_t>(toIndex(u, extents)));
+        if (position != NONE and not matches[position].match(grid)) {
+          erase_at(position);
+        }
+      }
+    }
+  }
+
+  for (const auto& match : matcher ? matcher->scan(grid, rules, dirty_boxes(history), anchors)
+                                    : Match::scan(grid, rules, history, anchors)) {
+    insert(match);
+  }
+}
+
+auto MatchIndex::insert(const Match& match) noexcept -> bool {
+  const auto k = key(match);
+  if (slot(k) != NONE) return false;
+
+  assign(k, static_cast<stk::u32>(stdr::size(matches)));
+  matches.push_back(match);
+  if (weighted) weights.push_back(match.w);
+  return true;
+}
+
+auto MatchIndex::erase_at(std::size_t position) noexcept -> void {
+  assign(key(matches[position]), NONE);
+  if (position + 1u != stdr::size(matches)) {
+    matches[position] = std::move(matches.back());
+    assign(key(matches[position]), static_cast<stk::u32>(position));
+    if (weighted) weights.set(position, matches[position].w);
+  }
+  matches.pop_back();
+  if (weighted) weights.pop_back();
+}
+
+auto MatchIndex::erase(iterator first, iterator last) noexcept -> iterator {
+  for (const auto& match : stdr::subrange(first, last)) {
+    assign(key(match), NONE);
+  }
+  for (auto n = stdr::distance(first, last); weighted and n > 0; --n) {
+    weights.pop_back();
+  }
+  auto next = matches.erase(first, last);
+  reindex(next, stdr::end(matches));
+  return next;
+}
+
+auto MatchIndex::clear() noexcept -> void {
+  matches.clear();
+  rows.clear();
+  slots.clear();
+  sparse.clear();
+  weights.clear();
+}
+
+auto MatchIndex::swap(iterator a, iterator b) noexcept -> void {
+  std::iter_swap(a, b);
+  for (auto it : { a, b }) {
+    auto position = static_cast<std::size_t>(stdr::distance(stdr::begin(matches), it));
+    assign(key(*it), static_cast<stk::u32>(position));
+    if (weighted) weights.set(position, it->w);
+  }
+}
+
+auto MatchIndex::reindex(iterator first, iterator last) noexcept -> void {
+  for (auto it = first; it != last; ++it) {
+    auto position = static_cast<std::size_t>(stdr::distance(stdr::begin(matches), it));
+    assign(key(*it), static_cast<stk::u32>(position));
+    if (weighted) weights.set(position, it->w);
+  }
+}
+
+auto MatchIndex::reweigh(iterator first, iterator last) noexcept -> void {
+  for (auto it = first; it != last; ++it) {
+    assign(key(*it), static_cast<stk::u32>(stdr::distance(stdr::begin(matches), it)));
+  }
+  if (weighted) weights.assign(matches | stdv::transform(&Match::w));
+}
+
+auto MatchIndex::contains(const Match& match) const noexcept -> bool {
+  return not stdr::empty(rows)
+     and rows[match.r] != NONE
+     and slot(key(match)) != NONE;
+}
+
+auto MatchIndex::begin() noexcept -> iterator {
+  return stdr::begin(matches);
+}
+
+auto MatchIndex::end() noexcept -> iterator {
+  return stdr::end(matches);
+}
+
+auto MatchIndex::begin() const noexcept -> const_iterator {
+  return stdr::begin(matches);
+}
+
+auto MatchIndex::end() const noexcept -> const_iterator {
+  return stdr::end(matches);
+}
+
+auto MatchIndex::size() const noexcept -> std::size_t {
+  return stdr::size(matches);
+}
+
+auto MatchIndex::empty() const noexcept -> bool {
+  return stdr::empty(matches);
+}
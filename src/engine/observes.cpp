@@ -3,18 +3,22 @@ module engine.observes;
 import log;
 import geometry;
 import engine.match;
+import workers;
 
 namespace stdr = std::ranges;
 namespace stdv = std::views;
 
-auto Observe::goal_reached(const Grid<char>& grid, const Future& future) noexcept -> bool {
+/** Fronts of a level from which their matches are searched on the workers */
+static constexpr auto PARALLEL_FRONTS = 1uz << 10;
+
+auto Observe::goal_reached(const Grid<symbol>& grid, const Future& future) noexcept -> bool {
   return stdr::all_of(stdv::zip(grid, future), [](const auto& gf) static {
     const auto& [g, f] = gf;
-    return stdr::contains(f, g);
+    return f.contains(g);
   });
 }
 
-auto Observe::future(std::vector<Change<char>>& changes, std::optional<Future>& future, const Grid<char>& grid, const Observes& observes) noexcept -> void {
+auto Observe::future(std::vector<Change<symbol>>& changes, std::optional<Future>& future, const Grid<symbol>& grid, const Observes& observes) noexcept -> void {
   auto values = charset{};
   auto okeys = observes | stdv::keys | stdr::to<charset>();
 
@@ -22,14 +26,14 @@ auto Observe::future(std::vector<Change<char>>& changes, std::optional<Future>&
     std::from_range,
     mdiota(grid.area()) | stdv::transform([&](auto u) noexcept {
       const auto value = grid[u];
-      if (stdr::contains(okeys, value)) {
+      if (okeys.contains(value)) {
         values.insert(value);
         const auto& obs = observes.at(value);
         if (obs.from) changes.emplace_back(u, *obs.from);
         return obs.to;
       }
       else {
-        return std::unordered_set{ value };
+        return charset{ value };
       }
     }),
     grid.extents
@@ -41,54 +45,73 @@ auto Observe::future(std::vector<Change<char>>& changes, std::optional<Future>&
 }
 
 auto Observe::backward_potentials(Potentials& potentials, const Future& future, std::span<const RewriteRule> rules) noexcept -> void {
-  for (auto c : stdv::keys(potentials)) {
-    stdr::fill(potentials.at(c).values, std::numeric_limits<double>::quiet_NaN());
-  }
-  const auto update = [&extents = future.extents, &potentials](const auto& cu, auto p) noexcept {
+  potentials.unset();
+  const auto update = [&extents = future.extents, &potentials](const auto& cu, Potentials::Distance p) noexcept {
     const auto& [c, u] = cu;
     if (not potentials.contains(c)) {
-      potentials.emplace(c, Potential{ extents, std::numeric_limits<double>::quiet_NaN() });
+      potentials.emplace(c, extents);
     }
-    potentials.at(c)[u] = p;
-    return std::tuple{ c, u, p };
+    potentials.set(c, u, p);
+    return std::tuple{ c, u };
   };
-  propagate(
-    stdv::zip(future, mdiota(future.area()))
-      | stdv::transform([](const auto& zero) static noexcept {
-          const auto& [f, u] = zero;
-          return f | stdv::transform([u](auto c) noexcept {
-            return std::tuple{ c, u };
-          });
+
+  /* matches whose outputs all reach the goal within p steps, which the writes of the level, at p + 1, leave unchanged */
+  const auto matches = [&potentials, rules](symbol c, Area3::Offset u, Potentials::Distance p) noexcept {
+    return stdv::zip(rules, stdv::iota(0u))
+      | stdv::transform([p_area = potentials.area(), c, u](const auto& v) noexcept {
+          const auto& [rule, r] = v;
+          return rule.get_oshifts(c)
+               | stdv::transform(std::bind_front(std::minus<Area3::Offset>{}, u))
+               | stdv::filter([p_area, r_area = rule.input.area()](auto u) noexcept {
+                   auto ru_area = r_area + u;
+                   return p_area.meet(ru_area) == ru_area;
+               })
+               | stdv::transform([r](auto u) noexcept {
+                   return std::tuple{ u, r };
+               });
       })
       | stdv::join
-      | stdv::transform(std::bind_back(update, 0.0)),
-    [&potentials, &rules, &update](auto&& front) noexcept {
-      auto [c, u, p] = front;
-      return stdv::zip(rules, stdv::iota(0u))
-        | stdv::transform([p_area = potentials.at(c).area(), c, u](const auto& v) noexcept {
-            const auto& [rule, r] = v;
-            return rule.get_oshifts(c)
-                 | stdv::transform(std::bind_front(std::minus<Area3::Offset>{}, u))
-                 | stdv::filter([p_area, r_area = rule.input.area()](auto u) noexcept {
-                     auto ru_area = r_area + u;
-                     return p_area.meet(ru_area) == ru_area;
-                 })
-                 | stdv::transform([r](auto u) noexcept {
-                     return std::tuple{ u, r };
-                 });
+      | stdv::transform([rules](auto&& ur) noexcept {
+          return Match{ rules, std::get<0>(ur), std::get<1>(ur) };
+      })
+      | stdv::filter(std::bind_back(&Match::backward_match, std::cref(potentials), static_cast<double>(p)))
+      | stdr::to<std::vector>();
+  };
 
-        })
-        | stdv::join
-        | stdv::transform([rules](auto&& ur) noexcept {
-            return Match{ rules, std::get<0>(ur), std::get<1>(ur) };
-        })
-        | stdv::filter(std::bind_back(&Match::backward_match, std::cref(potentials), p))
-        | stdv::transform(std::bind_back(&Match::backward_changes, std::cref(potentials)))
-        | stdv::join
-        | stdv::transform([](auto&& ch) static noexcept {
-            return std::tuple{ ch.value, ch.u };
-        })
-        | stdv::transform(std::bind_back(update, p + 1.0));
+  auto level = stdv::zip(future, mdiota(future.area()))
+    | stdv::transform([](const auto& zero) static noexcept {
+        const auto& [f, u] = zero;
+        return f | stdv::transform([u](auto c) noexcept {
+          return std::tuple{ c, u };
+        });
+    })
+    | stdv::join
+    | stdv::transform(std::bind_back(update, Potentials::Distance{ 0 }))
+    | stdr::to<std::vector>();
+
+  /* level by level : the matches of the fronts are found concurrently, then their changes are written in queue order */
+  auto found = std::vector<std::vector<Match>>{};
+  for (auto p = Potentials::Distance{ 0 }; not stdr::empty(level); ++p) {
+    found.clear();
+    found.resize(stdr::size(level));
+    const auto task = [&level, &found, &matches, p](std::size_t first, std::size_t last) noexcept {
+      for (auto k = first; k < last; ++k) {
+        const auto& [c, u] = level[k];
+        found[k] = matches(c, u, p);
+      }
+    };
+    if (stdr::size(level) < PARALLEL_FRONTS) task(0uz, stdr::size(level));
+    else Workers::shared().parallel_ranges(stdr::size(level), PARALLEL_FRONTS / 4u, task);
+
+    auto next = std::vector<std::tuple<symbol, Area3::Offset>>{};
+    for (const auto& match : found | stdv::join) {
+      next.append_range(
+        match.backward_changes(potentials)
+          | stdv::transform([&update, p](const auto& ch) noexcept {
+              return update(std::tuple{ ch.value, ch.u }, p + 1u);
+          })
+      );
     }
-  );
+    level = std::move(next);
+  }
 }
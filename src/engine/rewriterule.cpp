@@ -14,79 +14,102 @@ auto RewriteRule::parse(
   std::string_view output,
   double p
 ) noexcept -> RewriteRule {
+  const auto resolve = [&unions](char raw) noexcept -> const charset& {
+    stk::ensures(
+      unions.contains(raw),
+      std::format("unknown symbol '{}' in rule", raw)
+    );
+    return unions.at(raw);
+  };
+
   return {
-    Grid<Input>::parse(input, [&unions](auto raw) noexcept -> Input {
-      return raw == IGNORED_SYMBOL ? Input {} : Input { unions.contains(raw) ? unions.at(raw) : std::unordered_set{ raw } };
+    Grid<Input>::parse(input, [&resolve](auto raw) noexcept -> Input {
+      return raw == IGNORED_SYMBOL ? Input {} : Input { resolve(raw) };
     }),
-    Grid<Output>::parse(output, [](auto raw) noexcept -> Output {
-      return raw == IGNORED_SYMBOL ? Output {} : Output { raw };
+    Grid<Output>::parse(output, [&resolve](auto raw) noexcept -> Output {
+      if (raw == IGNORED_SYMBOL) return Output {};
+      const auto& values = resolve(raw);
+      stk::ensures(
+        stdr::size(values) == 1u,
+        std::format("union symbol '{}' can't be used as rule output", raw)
+      );
+      return Output { *stdr::begin(values) };
     }),
     p
   };
 }
 
+/** Lays out, for each symbol up to the greatest one accepted, the ignored cells then the cells accepting it */
+auto shift_table(const std::vector<std::tuple<RewriteRule::Input, Area3::Offset>>& cells) noexcept -> RewriteRule::Shifts {
+  const auto ignored = cells
+    | stdv::filter([](const auto& cell) static noexcept { return not std::get<0>(cell); })
+    | stdv::elements<1>
+    | stdr::to<std::vector>();
+
+  const auto accepted = stdr::fold_left(
+    cells
+      | stdv::elements<0>
+      | stdv::filter([](const auto& i) static noexcept { return i.has_value(); }),
+    charset{}, [](const auto& acc, const auto& i) static noexcept { return acc | *i; }
+  );
+  const auto count = stdr::empty(accepted) ? 0uz : std::size_t{ stdr::max(accepted) } + 1u;
+
+  auto shifts = RewriteRule::Shifts{};
+  shifts.starts.push_back(0u);
+  for (auto c = 0uz; c < count; ++c) {
+    shifts.offsets.append_range(ignored);
+    shifts.offsets.append_range(
+      cells
+        | stdv::filter([c](const auto& cell) noexcept {
+            const auto& i = std::get<0>(cell);
+            return i and i->contains(static_cast<symbol>(c));
+        })
+        | stdv::elements<1>
+    );
+    shifts.starts.push_back(static_cast<stk::u32>(stdr::size(shifts.offsets)));
+  }
+  /* trailing span for the symbols the rule never accepts */
+  shifts.offsets.append_range(ignored);
+  shifts.starts.push_back(static_cast<stk::u32>(stdr::size(shifts.offsets)));
+
+  return shifts;
+}
+
+auto RewriteRule::Shifts::operator[](symbol c) const noexcept -> std::span<const Area3::Offset> {
+  const auto s = std::min(std::size_t{ c }, stdr::size(starts) - 2u);
+  return std::span{ offsets }.subspan(starts[s], starts[s + 1u] - starts[s]);
+}
+
 RewriteRule::RewriteRule(Grid<Input>&& _input, Grid<Output>&& _output, double p, bool _is_copy) noexcept
 : input{std::move(_input)},
   output{std::move(_output)},
   draw{p},
   is_copy{_is_copy},
-  ishifts{
-    std::from_range,
+  kernel{Kernel::select(input.area().size)},
+  ishifts{shift_table(
     stdv::zip(input, mdiota(input.area()))
-      | stdv::transform([](auto&& p) noexcept {
+      | stdv::transform([](auto&& p) static noexcept {
           auto [i, u] = p;
-          // TODO this must change when fixing size of state representation
-          return i.value_or(std::unordered_set{ IGNORED_SYMBOL }) 
-            | stdv::transform([u](auto c) noexcept {
-                return std::tuple{ c, u };
-            });
+          return std::tuple{ i, u };
       })
-      | stdv::join
-  },
-  oshifts{
-    std::from_range,
+      | stdr::to<std::vector>()
+  )},
+  oshifts{shift_table(
     stdv::zip(output, mdiota(output.area()))
-      | stdv::transform([](auto&& p) noexcept {
+      | stdv::transform([](auto&& p) static noexcept {
           auto [o, u] = p;
-          return std::tuple{ o.value_or(IGNORED_SYMBOL), u };
+          return std::tuple{ o.transform([](auto c) static noexcept { return charset{ c }; }), u };
       })
-  }
+      | stdr::to<std::vector>()
+  )}
 {}
 
-auto RewriteRule::get_ishifts(char c) const noexcept -> std::vector<Area3::Offset>{
-  auto shifts = std::vector<Area3::Offset>{};
-
-  auto ignored_bucket = ishifts.bucket(IGNORED_SYMBOL);
-  auto bucket         = ishifts.bucket(c);
-
-  shifts.append_range(
-    stdr::subrange(ishifts.cbegin(ignored_bucket), ishifts.cend(ignored_bucket))
-      | stdv::transform(stk::monadic::get<1>())
-  );
-  shifts.append_range(
-    stdr::subrange(ishifts.cbegin(bucket), ishifts.cend(bucket))
-      | stdv::transform(stk::monadic::get<1>())
-  );
-
-  return shifts;
+auto RewriteRule::get_ishifts(symbol c) const noexcept -> std::span<const Area3::Offset> {
+  return ishifts[c];
 }
 
-auto RewriteRule::get_oshifts(char c) const noexcept -> std::vector<Area3::Offset>{
-  auto shifts = std::vector<Area3::Offset>{};
-
-  auto ignored_bucket = oshifts.bucket(IGNORED_SYMBOL);
-  auto bucket         = oshifts.bucket(c);
-
-  shifts.append_range(
-    stdr::subrange(oshifts.cbegin(ignored_bucket), oshifts.cend(ignored_bucket))
-      | stdv::transform(stk::monadic::get<1>())
-  );
-  shifts.append_range(
-    stdr::subrange(oshifts.cbegin(bucket), oshifts.cend(bucket))
-      | stdv::transform(stk::monadic::get<1>())
-  );
-
-  return shifts;
+auto RewriteRule::get_oshifts(symbol c) const noexcept -> std::span<const Area3::Offset> {
+  return oshifts[c];
 }
 
 auto RewriteRule::operator==(const RewriteRule& other) const noexcept -> bool {
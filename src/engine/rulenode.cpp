@@ -4,6 +4,7 @@ import sort;
 import geometry;
 
 import log;
+import workers;
 
 namespace stk  = stormkit;
 namespace stdr = std::ranges;
@@ -28,32 +29,55 @@ RuleNode::RuleNode(RuleNode::Mode _mode, std::vector<RewriteRule>&& _rules, Rewr
   inference{Inference::SEARCH}, limit{_limit}, depthCoefficient{_depthCoefficient}, observes{std::move(_observes)}
 {}
 
-auto RuleNode::operator()(const TracedGrid<char>& grid, std::vector<Change<char>>& changes) noexcept -> void {
+/** Amount of work, in matches or cells, from which draws and inference are spread over the workers */
+static constexpr auto PARALLEL_ITEMS = 1uz << 14;
+
+/** Items of the given weight in each range handed to a worker */
+static constexpr auto grain(std::size_t weight) noexcept -> std::size_t {
+  return std::max(PARALLEL_ITEMS / 4u / weight, 1uz);
+}
+
+/** Runs task over [0, n), in ranges of grain(weight) items spread over the workers when the n items weigh enough */
+static auto chunks(std::size_t n, std::size_t weight, const Workers::RangeTask& task) noexcept -> void {
+  if (n * weight < PARALLEL_ITEMS) {
+    task(0uz, n);
+    return;
+  }
+  Workers::shared().parallel_ranges(n, grain(weight), task);
+}
+
+auto RuleNode::operator()(const TracedGrid<symbol>& grid, std::vector<Change<symbol>>& changes) noexcept -> void {
+  tick++;
   if (not predict(grid, changes)) return;
   if (not stdr::empty(trajectory)) {
     const auto& new_grid = trajectory.back();
     changes.append_range(
-      stdv::zip(grid, new_grid, mdiota(grid.area()))
+      stdv::zip(grid.cells(), new_grid, mdiota(grid.area()))
         | stdv::filter([](const auto& t) static noexcept {
             auto [g, n, _] = t;
             return g != n;
         })
         | stdv::transform([](const auto& t) static noexcept {
             auto [_, n, u] = t;
-            return Change<char>{ u, n };
+            return Change<symbol>{ u, n };
         })
     );
     trajectory.pop_back();
     return;
   }
+  if (cell_rules) {
+    apply_cells(grid, changes);
+    return;
+  }
   scan(grid);
   infer(grid);
-  select();
+  select(grid);
   apply(grid, changes);
 }
 
 auto RuleNode::reset() noexcept -> void {
   potentials.clear();
+  distances.clear();
   future = std::nullopt;
   trajectory.clear();
   matches.clear();
@@ -61,55 +85,209 @@ auto RuleNode::reset() noexcept -> void {
   prev = {};
 }
 
-template <typename ...T>
-struct std::hash<std::tuple<T...>> {
-  constexpr auto operator()(std::tuple<T...> t) const noexcept -> std::size_t {
-    return std::apply([](T ...args) static noexcept {
-      return (std::hash<T>{}(args) ^ ...);
-    }, t);
+auto RuleNode::reseed(std::uint64_t seed) noexcept -> void {
+  rng.seed(seed);
+  draws = Philox{ rng() };
+  tick  = 0;
+}
+
+auto RuleNode::share(std::shared_ptr<Field::Store> _store) noexcept -> void {
+  store = std::move(_store);
+  distances.clear();
+}
+
+auto RuleNode::requirements_of(std::span<const RewriteRule> rules) noexcept -> std::vector<std::vector<charset>> {
+  auto requirements = std::vector<std::vector<charset>>{};
+  for (const auto& rule : rules) {
+    auto sets = std::vector<charset>{};
+    for (const auto& i : rule.input) {
+      if (i and stdr::find(sets, *i) == stdr::end(sets)) sets.push_back(*i);
+    }
+    /* symmetric copies of a rule need the same symbols */
+    if (stdr::find(requirements, sets) == stdr::end(requirements)) requirements.push_back(std::move(sets));
   }
-};
-
-auto RuleNode::scan(const TracedGrid<char>& grid) noexcept -> void {
-  auto now = stdr::cend(grid.history);
-  auto since = prev
-    .transform(std::bind_front(stdr::next, stdr::cbegin(grid.history)))
-    .value_or(now);
-
-  matches.erase(
-    stdr::begin(stdr::remove_if(
-      matches, std::not_fn(std::bind_back(&Match::match, std::cref(grid)))
-    )),
-    stdr::end(matches)
-  );
+  return requirements;
+}
 
-  auto history = stdr::subrange(since, now) | stdr::to<std::vector>();
+auto RuleNode::viable(const TracedGrid<symbol>& grid) const noexcept -> bool {
+  if (inference == Inference::OBSERVE or inference == Inference::SEARCH) return true;
 
-  matches.append_range(Match::scan(grid, rules, history));
+  const auto present = charset{
+    std::from_range,
+    stdv::iota(0uz, stdr::size(grid.occurrences().cells))
+      | stdv::filter([&grid](auto c) noexcept { return grid.occurrences().count(c) > 0u; })
+  };
 
-  active = stdr::begin(matches);
+  return stdr::any_of(requirements, [&present](const auto& sets) noexcept {
+    return stdr::all_of(sets, [&present](const auto& set) noexcept {
+      return not stdr::empty(set & present);
+    });
+  });
 }
 
-auto RuleNode::apply(const TracedGrid<char>& grid, std::vector<Change<char>>& changes) -> void {
-  if (active != stdr::end(matches))
-    prev = stdr::size(grid.history);
+auto RuleNode::compile(Mode mode, std::span<const RewriteRule> rules, Inference inference) noexcept
+-> std::optional<CellRules> {
+  if (mode == Mode::ONE or inference != Inference::RANDOM) return std::nullopt;
+  if (stdr::empty(rules)) return std::nullopt;
+  if (not stdr::all_of(rules, [](const auto& rule) static noexcept {
+    return rule.input.area().size == Area3::Size{ 1u, 1u, 1u };
+  })) return std::nullopt;
+
+  auto table = CellRules{};
+  for (auto r = 0uz; r < stdr::size(rules); ++r) {
+    const auto& i = rules[r].input.values[0];
+    const auto& o = rules[r].output.values[0];
+    /* a rule writing nothing neither changes nor claims its cell */
+    if (not o) continue;
+    for (auto c : i.value_or(charset{ std::from_range, stdv::iota(0uz, charset::CAPACITY) })) {
+      table.candidates[c].push_back(static_cast<stk::u32>(r));
+      if (*o != c) table.live.insert(c);
+    }
+  }
 
+  auto deterministic = stdr::all_of(table.candidates, [](const auto& candidates) static noexcept {
+    return stdr::size(candidates) <= 1u;
+  }) and (mode == Mode::ALL or stdr::all_of(rules, [](const auto& rule) static noexcept {
+    return rule.draw.p() == 1.0;
+  }));
+
+  if (deterministic) {
+    auto& rewrite = table.rewrite.emplace();
+    for (auto c = 0uz; c < charset::CAPACITY; ++c) {
+      const auto& candidates = table.candidates[c];
+      rewrite[c] = stdr::empty(candidates) ? static_cast<symbol>(c)
+                 : *rules[candidates.front()].output.values[0];
+    }
+  }
+
+  return table;
+}
+
+auto RuleNode::apply_cells(const TracedGrid<symbol>& grid, std::vector<Change<symbol>>& changes) noexcept -> void {
+  const auto size  = fromExtents(grid.extents());
+  const auto rows  = size.y * size.z;
+  const auto cells = stdr::size(grid.values());
+
+  /* each cell draws from its own counter, so a cell gives the same changes whatever thread or pass visits it */
+  const auto visit = [this, &grid](Area3::Offset u, std::size_t i, CellPass& out) noexcept {
+    const auto c      = grid.values()[i];
+    const auto before = stdr::size(out.changes);
+
+    if (cell_rules->rewrite) {
+      if (auto o = (*cell_rules->rewrite)[c]; o != c) out.changes.push_back({ u, o });
+      return;
+    }
+
+    const auto& candidates = cell_rules->candidates[c];
+    if (stdr::empty(candidates)) return;
+
+    if (mode == Mode::ALL) {
+      /* the first match of a random order claims the cell, which is a uniform pick */
+      const auto picked = draws.below(tick, i, stdr::size(candidates));
+      if (auto o = *rules[candidates[picked]].output.values[0]; o != c) out.changes.push_back({ u, o });
+    }
+    else {
+      for (auto r : candidates) {
+        if (draws.uniform(tick, i * stdr::size(rules) + r) >= rules[r].draw.p()) continue;
+        if (auto o = *rules[r].output.values[0]; o != c) out.changes.push_back({ u, o });
+      }
+    }
+
+    /* a cell left as it is that a later draw may still change */
+    if (stdr::size(out.changes) == before and cell_rules->live.contains(c)) out.waiting.push_back(u);
+  };
+
+  const auto row_cells = [&visit, size](std::size_t row, CellPass& out) noexcept {
+    const auto y = row % size.y;
+    const auto z = row / size.y;
+    for (auto x = 0uz, i = row * size.x; x < size.x; ++x, ++i) visit({ x, y, z }, i, out);
+  };
+
+  const auto changed_since = since(grid);
+
+  auto& pass = stdr::empty(passes) ? passes.emplace_back() : passes.front();
+
+  /* once the whole grid went through, a cell only has a new outcome when it changed or when its draws may still change it */
+  if (changed_since and stdr::size(*changed_since) * REVISIT_SHARE + stdr::size(pass.waiting) <= cells) {
+    visited.reset(grid.extents());
+    changed.clear();
+    for (auto u : pass.waiting) visited.mark(u);
+    for (const auto& change : *changed_since) if (visited.mark(change.u)) changed.push_back(change.u);
+
+    /* waiting cells come in grid order from the pass that left them, only the changed ones need sorting */
+    const auto index = [&grid](Area3::Offset u) noexcept { return static_cast<std::size_t>(toIndex(u, grid.extents())); };
+    stdr::sort(changed, {}, index);
+    revisit.clear();
+    stdr::merge(pass.waiting, changed, std::back_inserter(revisit), {}, index, index);
+
+    pass.changes.clear();
+    pass.waiting.clear();
+    for (auto u : revisit) visit(u, index(u), pass);
+
+    changes.append_range(pass.changes);
+    return;
+  }
+
+  if (cells < PARALLEL_ITEMS) {
+    pass.changes.clear();
+    pass.waiting.clear();
+    for (auto row = 0uz; row < rows; ++row) row_cells(row, pass);
+
+    changes.append_range(pass.changes);
+    return;
+  }
+
+  /* one pass per range of rows, kept from step to step and gathered back in range order, the first one keeping every waiting cell */
+  const auto rows_per_range = grain(size.x);
+  passes.resize((rows + rows_per_range - 1u) / rows_per_range);
+  for (auto& p : passes) {
+    p.changes.clear();
+    p.waiting.clear();
+  }
+
+  chunks(rows, size.x, [this, &row_cells, rows_per_range](std::size_t first, std::size_t last) noexcept {
+    auto& out = passes[first / rows_per_range];
+    for (auto row = first; row < last; ++row) row_cells(row, out);
+  });
+
+  auto& waiting = passes.front().waiting;
+  for (const auto& p : passes) changes.append_range(p.changes);
+  for (const auto& p : passes | stdv::drop(1)) waiting.append_range(p.waiting);
+}
+
+auto RuleNode::since(const TracedGrid<symbol>& grid) noexcept -> std::optional<std::span<const Change<symbol>>> {
+  const auto size = stdr::size(grid.history());
+  const auto last = std::exchange(prev, static_cast<stk::ioffset>(size));
+  const auto same = std::exchange(generation, grid.generation()) == grid.generation();
+
+  if (not last or not same or static_cast<std::size_t>(*last) > size) return std::nullopt;
+  return grid.history().subspan(static_cast<std::size_t>(*last));
+}
+
+auto RuleNode::scan(const TracedGrid<symbol>& grid) noexcept -> void {
+  if (const auto changes = since(grid)) matches.update(grid, rules, *changes);
+  else                                  matches.rebuild(grid, rules);
+
+  active = stdr::begin(matches);
+}
+
+auto RuleNode::apply(const TracedGrid<symbol>& grid, std::vector<Change<symbol>>& changes) -> void {
   changes.append_range(
-    stdr::subrange(active, stdr::cend(matches))
-      | stdv::transform(std::bind_back(&Match::changes, std::cref(grid)))
+    stdr::subrange(active, stdr::end(matches))
+      | stdv::transform(std::bind_back(&Match::changes, std::cref(grid.cells())))
       | stdv::join
   );
 
   matches.erase(active, stdr::end(matches));
 }
 
-auto RuleNode::predict(const Grid<char>& grid, std::vector<Change<char>>& changes) noexcept -> bool {
+auto RuleNode::predict(const TracedGrid<symbol>& grid, std::vector<Change<symbol>>& changes) noexcept -> bool {
   switch (inference) {
     case Inference::RANDOM:
       return true;
 
     case Inference::DISTANCE:
-      Field::potentials(fields, grid, potentials);
+      Field::potentials(fields, grid, potentials, distances, *store);
       if (Field::essential_missing(fields, potentials)) {
         return false;
       }
@@ -163,82 +341,127 @@ auto RuleNode::predict(const Grid<char>& grid, std::vector<Change<char>>& change
   }
 }
 
-auto RuleNode::select() noexcept -> void {
+auto RuleNode::select(const Grid<symbol>& grid) noexcept -> void {
   switch (mode) {
     case Mode::ONE:
       if (auto picked = pick(active, stdr::end(matches));
                picked != stdr::end(matches)
       ) {
         active = stdr::prev(stdr::end(matches));
-        std::iter_swap(picked, active);
+        matches.swap(picked, active);
       }
       else {
         active = stdr::end(matches);
       }
       break;
 
-    case Mode::ALL:
-      for (auto selection = stdr::end(matches);
-                selection != active;
-      ) {
-        if (auto picked = pick(active, selection);
-                 picked != selection
-        ) {
-          auto conflict = stdr::any_of(
-            selection, stdr::end(matches),
-            std::bind_back(&Match::conflict, *picked)
-          );
-          std::iter_swap(
-            picked,
-            conflict ? active++ : --selection
-          );
-        }
-        else {
-          active = selection;
+    case Mode::ALL: {
+      occupancy.reset(grid.extents);
+
+      /* exponential race : claiming cells by increasing E/w, E ~ Exp(1), is drawing without replacement by weight */
+      const auto n = static_cast<std::size_t>(stdr::distance(active, stdr::end(matches)));
+      race.resize(n);
+      chunks(n, 1uz, [this, &grid](std::size_t first, std::size_t last) noexcept {
+        for (auto i = first; i < last; ++i) {
+          const auto& match = active[static_cast<std::ptrdiff_t>(i)];
+          const auto key = id(match, grid);
+          const auto e = -std::log1p(-draws.uniform(tick, key));
+          race[i] = {
+            match.w > 0.0 ? e / match.w : std::numeric_limits<double>::infinity(),
+            key,
+            static_cast<std::uint32_t>(i)
+          };
         }
+      });
+      stdr::sort(race);
+
+      chosen.assign(n, 0u);
+      for (const auto& [priority, _, i] : race) {
+        if (std::isinf(priority)) break;
+        chosen[i] = occupy(active[static_cast<std::ptrdiff_t>(i)]);
       }
+      keep();
       break;
+    }
 
-    case Mode::PRL:
-      active = stdr::begin(stdr::partition(
-        active, stdr::end(matches),
-        std::not_fn([this](const auto& match) noexcept {
-          return rules[match.r].draw(rng);
-        })
-      ));
+    case Mode::PRL: {
+      const auto n = static_cast<std::size_t>(stdr::distance(active, stdr::end(matches)));
+      chosen.resize(n);
+      chunks(n, 1uz, [this, &grid](std::size_t first, std::size_t last) noexcept {
+        for (auto i = first; i < last; ++i) {
+          const auto& match = active[static_cast<std::ptrdiff_t>(i)];
+          chosen[i] = draws.uniform(tick, id(match, grid)) < rules[match.r].draw.p();
+        }
+      });
+      keep();
       break;
+    }
   }
 }
 
-auto RuleNode::pick(MatchIterator begin, MatchIterator end) noexcept -> MatchIterator {
-  auto weights =
-    stdr::subrange(begin, end)
-      | stdv::transform(&Match::w);
+auto RuleNode::id(const Match& match, const Grid<symbol>& grid) const noexcept -> std::uint64_t {
+  return static_cast<std::uint64_t>(match.r) * stdr::size(grid.values)
+       + static_cast<std::uint64_t>(toIndex(match.u, grid.extents));
+}
 
-  if (stdr::fold_left(weights, 0.0, std::plus{}) == 0.0) {
-    return end;
+/** Moves the chosen matches to the end, where apply takes them from */
+auto RuleNode::keep() noexcept -> void {
+  const auto first = active;
+  auto zipped = stdv::zip(stdr::subrange(first, stdr::end(matches)), chosen);
+  auto kept   = stdr::partition(zipped, [](const auto& t) static noexcept { return std::get<1>(t) == 0u; });
+  active = stdr::next(first, stdr::distance(stdr::begin(zipped), stdr::begin(kept)));
+  matches.reindex(first, stdr::end(matches));
+}
+
+auto RuleNode::occupy(const Match& match) noexcept -> bool {
+  auto cells = stdv::zip(mdiota(match.area()), rules[match.r].output)
+    | stdv::filter([](const auto& output) static noexcept {
+        return std::get<1>(output) != std::nullopt;
+    })
+    | stdv::elements<0>;
+
+  if (stdr::any_of(cells, std::bind_front(&Stamps::marked, std::cref(occupancy)))) {
+    return false;
   }
 
-  auto picker = std::discrete_distribution{ stdr::cbegin(weights), stdr::cend(weights) };
+  for (auto u : cells) occupancy.mark(u);
+  return true;
+}
 
-  return stdr::next(begin, picker(rng));
+auto RuleNode::pick(MatchIterator begin, MatchIterator end) noexcept -> MatchIterator {
+  if (begin == end) return end;
+
+  /* without inference every weight stays 1.0, a uniform draw is enough */
+  if (inference == Inference::RANDOM) {
+    auto picker = std::uniform_int_distribution{ std::ptrdiff_t{ 0 }, stdr::distance(begin, end) - 1 };
+    return stdr::next(begin, picker(rng));
+  }
+
+  return matches.sample(begin, end, rng);
 }
 
-auto RuleNode::infer(const Grid<char>& grid) noexcept -> void {
+auto RuleNode::infer(const Grid<symbol>& grid) noexcept -> void {
   if (stdr::empty(potentials)) return;
-  
-  auto min_w = std::numeric_limits<double>::infinity();
-
-  stdr::for_each(
-    active, stdr::end(matches),
-    [&potentials = potentials, &grid, &min_w](auto& m) mutable noexcept {
-      m.w = m.delta(grid, potentials);
-      if (is_normal(m.w)) {
-        min_w = std::min(min_w, m.w);
+
+  /* each match only writes its own weight, which makes the deltas and the softmax safe to spread */
+  chunks(
+    static_cast<std::size_t>(stdr::distance(active, stdr::end(matches))), 1uz,
+    [this, &grid](std::size_t first, std::size_t last) noexcept {
+      for (auto& m : stdr::subrange(stdr::next(active, first), stdr::next(active, last))) {
+        m.w = m.delta(grid, potentials);
       }
   });
+
+  const auto min_w = stdr::fold_left(
+    stdr::subrange(active, stdr::end(matches))
+      | stdv::transform(&Match::w)
+      | stdv::filter(is_normal),
+    std::numeric_limits<double>::infinity(),
+    [](auto a, auto b) static noexcept { return std::min(a, b); }
+  );
+  const auto first = active;
   auto p = stdr::partition(
-    active, stdr::end(matches),
+    first, stdr::end(matches),
     std::not_fn(is_normal),
     &Match::w
   );
@@ -246,13 +469,15 @@ auto RuleNode::infer(const Grid<char>& grid) noexcept -> void {
   active = stdr::begin(p);
   // dlog("preweights {}", stdr::subrange(active, stdr::end(matches)) | stdv::transform(&Match::w) | stdr::to<std::vector>());
 
-  stdr::for_each(
-    active, stdr::end(matches),
-    [min_w, &temperature = std::max(temperature, 0.1/*std::numeric_limits<double>::epsilon()*/)]
-    (auto& m) noexcept {
-      /** Boltzmann Softmax distribution */
-      m.w = std::exp(-(m.w - min_w) / temperature);
-    }
-  );
+  const auto t = std::max(temperature, 0.1/*std::numeric_limits<double>::epsilon()*/);
+  chunks(
+    static_cast<std::size_t>(stdr::distance(active, stdr::end(matches))), 1uz,
+    [this, min_w, t](std::size_t first, std::size_t last) noexcept {
+      for (auto& m : stdr::subrange(stdr::next(active, first), stdr::next(active, last))) {
+        /** Boltzmann Softmax distribution */
+        m.w = std::exp(-(m.w - min_w) / t);
+      }
+  });
+  matches.reweigh(first, stdr::end(matches));
   // dlog("weights {}", stdr::subrange(active, stdr::end(matches)) | stdv::transform(&Match::w) | stdr::to<std::vector>());
 }
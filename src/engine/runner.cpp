@@ -1,22 +1,24 @@
 module engine.runner;
 
 import log;
+import random;
 
 namespace stdr = std::ranges;
 
-auto RuleRunner::operator()(TracedGrid<char>& grid) noexcept -> std::generator<bool> {
+auto RuleRunner::operator()(TracedGrid<symbol>& grid) noexcept -> std::generator<bool> {
   if (steps > 0 and step >= steps) co_return;
+  if (not rulenode.viable(grid)) co_return;
 
-  auto changes = std::vector<Change<char>>{};
+  auto changes = std::vector<Change<symbol>>{};
   rulenode(grid, changes);
   if (stdr::empty(changes)) co_return;
 
-  stdr::for_each(changes, std::bind_front(&TracedGrid<char>::apply, &grid));
+  stdr::for_each(changes, std::bind_front(&TracedGrid<symbol>::apply, &grid));
   step++;
   co_yield true;
 }
 
-auto TreeRunner::operator()(TracedGrid<char>& grid) noexcept -> std::generator<bool> {
+auto TreeRunner::operator()(TracedGrid<symbol>& grid) noexcept -> std::generator<bool> {
   for (current_node  = stdr::begin(nodes);
        current_node != stdr::end(nodes);
   ) {
@@ -50,6 +52,39 @@ auto reset(NodeRunner& n) noexcept -> void {
   std::unreachable();
 }
 
+auto reseed(NodeRunner& n, SplitMix64& streams) noexcept -> void {
+  if (auto p = std::get_if<RuleRunner>(&n); p != nullptr) {
+    p->rulenode.reseed(streams());
+    return;
+  }
+
+  if (auto p = std::get_if<TreeRunner>(&n); p != nullptr) {
+    for (auto& c : p->nodes) reseed(c, streams);
+    return;
+  }
+
+  std::unreachable();
+}
+
+auto reseed(NodeRunner& n, std::uint64_t seed) noexcept -> void {
+  auto streams = SplitMix64{ seed };
+  reseed(n, streams);
+}
+
+auto share(NodeRunner& n, const std::shared_ptr<Field::Store>& store) noexcept -> void {
+  if (auto p = std::get_if<RuleRunner>(&n); p != nullptr) {
+    p->rulenode.share(store);
+    return;
+  }
+
+  if (auto p = std::get_if<TreeRunner>(&n); p != nullptr) {
+    for (auto& c : p->nodes) share(c, store);
+    return;
+  }
+
+  std::unreachable();
+}
+
 auto current(const NodeRunner& n) noexcept -> const RuleNode* {
   if (auto p = std::get_if<RuleRunner>(&n); p != nullptr) {
     return &p->rulenode;
@@ -10,9 +10,9 @@ namespace stdr = std::ranges;
 namespace stdv = std::views;
 
 template <>
-struct std::hash<Grid<char>::Extents> {
-  constexpr auto operator()(Grid<char>::Extents t) const noexcept -> std::size_t {
-    auto h = std::hash<Grid<char>::Extents::index_type>{};
+struct std::hash<Grid<symbol>::Extents> {
+  constexpr auto operator()(Grid<symbol>::Extents t) const noexcept -> std::size_t {
+    auto h = std::hash<Grid<symbol>::Extents::index_type>{};
     return h(t.extent(0))
          ^ h(t.extent(1))
          ^ h(t.extent(2));
@@ -23,7 +23,7 @@ template <typename T>
 struct std::hash<std::vector<T>> {
   constexpr auto operator()(const std::vector<T>& t) const noexcept -> std::size_t {
     auto s = std::size_t{ 0 };
-    auto h = std::hash<char>{};
+    auto h = std::hash<T>{};
     for (auto c : t)
       s ^= h(c);
     return s;
@@ -31,8 +31,8 @@ struct std::hash<std::vector<T>> {
 };
 
 template <>
-struct std::hash<Grid<char>> {
-  constexpr auto operator()(const Grid<char>& grid) const noexcept -> std::size_t {
+struct std::hash<Grid<symbol>> {
+  constexpr auto operator()(const Grid<symbol>& grid) const noexcept -> std::size_t {
     return std::hash<decltype(grid.extents)>{}(grid.extents)
          ^ std::hash<decltype(grid.values)>{}(grid.values);
   }
@@ -41,7 +41,7 @@ struct std::hash<Grid<char>> {
 auto Search::trajectory(
   Trajectory& traj,
   const Future& future,
-  const Grid<char>& grid,
+  const Grid<symbol>& grid,
   std::span<const RewriteRule> rules,
   bool all, stk::u32 limit, double depthCoefficient
 ) -> void {
@@ -165,25 +165,23 @@ auto Search::trajectory(
   }
 }
 
-auto Search::forward_potentials(Potentials& potentials, const Grid<char>& grid, std::span<const RewriteRule> rules) noexcept -> void {
-  for (auto c : stdv::keys(potentials)) {
-    stdr::fill(potentials.at(c).values, std::numeric_limits<double>::quiet_NaN());
-  }
+auto Search::forward_potentials(Potentials& potentials, const Grid<symbol>& grid, std::span<const RewriteRule> rules) noexcept -> void {
+  potentials.unset();
   const auto update = [&extents = grid.extents, &potentials](const auto& cu, auto p) noexcept {
     const auto& [c, u] = cu;
     if (not potentials.contains(c)) {
-      potentials.emplace(c, Potential{ extents, std::numeric_limits<double>::quiet_NaN() });
+      potentials.emplace(c, extents);
     }
-    potentials.at(c)[u] = p;
+    potentials.set(c, u, p);
     return std::tuple{ c, u, p };
   };
   propagate(
     stdv::zip(grid, mdiota(grid.area()))
-      | stdv::transform(std::bind_back(update, 0.0)),
+      | stdv::transform(std::bind_back(update, Potentials::Distance{ 0 })),
     [&potentials, &rules, &update](auto&& front) noexcept {
       auto [c, u, p] = front;
       return stdv::zip(rules, stdv::iota(0u))
-        | stdv::transform([p_area = potentials.at(c).area(), c, u](const auto& v) noexcept {
+        | stdv::transform([p_area = potentials.area(), c, u](const auto& v) noexcept {
             const auto& [rule, r] = v;
             return rule.get_ishifts(c)
                  | stdv::transform(std::bind_front(std::minus<Area3::Offset>{}, u))
@@ -199,23 +197,22 @@ auto Search::forward_potentials(Potentials& potentials, const Grid<char>& grid,
         | stdv::transform([rules](auto&& ur) noexcept {
             return Match{ rules, std::get<0>(ur), std::get<1>(ur) };
         })
-        | stdv::filter(std::bind_back(&Match::forward_match, std::cref(potentials), p))
+        | stdv::filter(std::bind_back(&Match::forward_match, std::cref(potentials), static_cast<double>(p)))
         | stdv::transform(std::bind_back(&Match::forward_changes, std::cref(potentials)))
         | stdv::join
         | stdv::transform([](auto&& ch) static noexcept {
             return std::tuple{ ch.value, ch.u };
         })
-        | stdv::transform(std::bind_back(update, p + 1.0));
+        | stdv::transform(std::bind_back(update, p + 1u));
     }
   );
 }
 
-auto Search::backward_delta(const Potentials& potentials, const Grid<char>& grid) noexcept -> double {
+auto Search::backward_delta(const Potentials& potentials, const Grid<symbol>& grid) noexcept -> double {
   auto vals = stdv::zip(mdiota(grid.area()), grid)
     | stdv::transform([&potentials] (const auto& locus) noexcept {
         auto [u, c] = locus;
-        return potentials.contains(c) ? potentials.at(c)[u]
-          : std::numeric_limits<double>::quiet_NaN();
+        return potentials.at(c, u);
     });
   
   return std::reduce(
@@ -233,8 +230,7 @@ auto Search::forward_delta(const Potentials& potentials, const Future& future) n
 
           auto candidates = f
             | stdv::transform([&potentials, u] (auto c) {
-                return potentials.contains(c) ? potentials.at(c)[u]
-                  : std::numeric_limits<double>::quiet_NaN();
+                return potentials.at(c, u);
             })
             | stdv::filter(is_normal)
             | stdr::to<std::vector>();
@@ -262,8 +258,8 @@ auto Candidate::weight(double depthCoefficient) const -> double {
 }
 
 // TODO maybe avoid duplication of rulenode logic ?
-auto Candidate::children(std::span<const RewriteRule> rules, bool all) const -> std::vector<Grid<char>> {
-  auto result = std::vector<Grid<char>>{};
+auto Candidate::children(std::span<const RewriteRule> rules, bool all) const -> std::vector<Grid<symbol>> {
+  auto result = std::vector<Grid<symbol>>{};
 
   auto matches = Match::scan(state, rules);
 
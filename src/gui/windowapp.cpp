@@ -8,12 +8,16 @@ module gui.windowapp;
 
 import log;
 import stormkit.core;
+import utils;
 
 import grid;
+import charset;
 import geometry;
 
 import engine.model;
 import engine.rulenode;
+import engine.interpreter;
+import engine.aot;
 import parser;
 import controls;
 
@@ -37,6 +41,7 @@ static const auto DEFAULT_MODEL_FILE   = "models/GoToGradient.xml"s;
 
 static constexpr auto DEFAULT_GRID_EXTENT = std::dims<3>{1u, 59u, 59u};
 static constexpr auto DEFAULT_TICKRATE = 60;
+static constexpr auto FRAME_BUDGET = std::chrono::milliseconds{ 1000 / DEFAULT_TICKRATE };
 
 static constexpr auto WINDOW_TITLE = "MarkovJunior";
 static constexpr auto WINDOW_SIZE  = stk::math::uextent2{800, 600};
@@ -69,26 +74,35 @@ auto WindowApp::operator()(std::span<const std::string_view> args) noexcept -> i
     modelarg != stdr::end(args) ? std::string{*modelarg} : DEFAULT_MODEL_FILE;
 
   ilog("loading model");
-  auto model = parser::Model(parser::document(modelfile));
+  auto seed = option(args, "--seed").transform([](auto s) static noexcept {
+    return fromBase<std::uint64_t>(s, 10);
+  });
+  auto model = aot::load(modelfile, seed);
 
   auto extent = DEFAULT_GRID_EXTENT;
-  auto grid = TracedGrid{extent, model.symbols[0]};
-  if (model.origin) grid[grid.area().center()] = model.symbols[1];
+  auto grid = TracedGrid{extent, symbol{0}};
+  if (model.origin) grid.set(grid.area().center(), symbol{1});
+
+  auto interpreter = Interpreter{ model.program, grid };
 
   auto controls = Controls {
     .tickrate = DEFAULT_TICKRATE,
-    .onReset = [&grid, &model]{
-      reset(model.program);
-      grid = TracedGrid{grid.extents, model.symbols[0]};
-      if (model.origin) grid[grid.area().center()] = model.symbols[1];
+    .onReset = [&grid, &model, &interpreter]{
+      interpreter.reset();
+      grid = TracedGrid{grid.extents(), symbol{0}};
+      if (model.origin) grid.set(grid.area().center(), symbol{1});
     },
   };
 
   ilog("start program thread");
-  auto program_thread = std::jthread{ [&grid, &model, &controls](std::stop_token stop) mutable noexcept {
+  auto program_thread = std::jthread{ [&model, &interpreter, &controls](std::stop_token stop) mutable noexcept {
     auto last_time = clk::now();
-    for (auto _ : model.program.visit([&grid](auto& f) noexcept { return f(grid); })) { // TODO replace with a while loop conditioned on the stop token, 
-      if (stop.stop_requested()) break;  //      and put the program tick inside (instead of async generator)
+    while (not stop.stop_requested()) {
+      /* with the rate limit off, a whole frame worth of steps runs between two syncs */
+      const auto progress = controls.fast_forward()
+        ? interpreter.run_for(FRAME_BUDGET)
+        : interpreter.run(1);
+      if (progress.halted) break;
 
       controls.rate_limit(last_time);
       controls.handle_next();
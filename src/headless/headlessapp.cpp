@@ -0,0 +1,244 @@
+module headless.headlessapp;
+
+import log;
+import stormkit.core;
+import utils;
+
+import grid;
+import charset;
+
+import headless.scheduler;
+import parser;
+
+namespace stk  = stormkit;
+namespace stdr = std::ranges;
+namespace stdv = std::views;
+
+using namespace std::string_literals;
+using clk = std::chrono::steady_clock;
+
+static const auto DEFAULT_MODEL_FILE = "models/GoToGradient.xml"s;
+static const auto DEFAULT_ENTRIES_FILE = "models.xml"s;
+
+static constexpr auto DEFAULT_GRID_EXTENT = std::dims<3>{1u, 59u, 59u};
+
+auto number(std::string_view value, std::string_view flag) noexcept -> std::uint64_t {
+  auto result = std::uint64_t{};
+  auto [end, error] = std::from_chars(stdr::data(value), stdr::data(value) + stdr::size(value), result);
+  stk::ensures(
+    error == std::errc{} and end == stdr::data(value) + stdr::size(value),
+    std::format("invalid value '{}' for '{}'", value, flag)
+  );
+  return result;
+}
+
+/** Reads `X`, `XxY` or `XxYxZ`, a lone X standing for a square of side X */
+auto extents(std::string_view value) noexcept -> std::dims<3> {
+  auto sizes = value
+    | stdv::split('x')
+    | stdv::transform([](auto&& s) static noexcept {
+        return number(std::string_view{ s }, "--size");
+    })
+    | stdr::to<std::vector>();
+
+  stk::ensures(
+    stdr::size(sizes) >= 1u and stdr::size(sizes) <= 3u
+      and stdr::all_of(sizes, [](auto s) static noexcept { return s > 0u; }),
+    std::format("invalid value '{}' for '{}', expected X, XxY or XxYxZ", value, "--size")
+  );
+
+  if (stdr::size(sizes) == 1u) sizes.push_back(sizes[0]);
+  if (stdr::size(sizes) == 2u) sizes.push_back(1u);
+  return std::dims<3>{ sizes[2], sizes[1], sizes[0] };
+}
+
+/** One line per row, layers being separated by an empty line */
+auto write(std::ostream& out, const Grid<symbol>& grid, std::string_view symbols) noexcept -> void {
+  const auto size = fromExtents(grid.extents);
+  for (auto z = 0uz; z < size.z; ++z) {
+    if (z > 0u) out << '\n';
+    for (auto y = 0uz; y < size.y; ++y) {
+      const auto row = std::span{ grid.values }.subspan((z * size.y + y) * size.x, size.x);
+      out << (row | stdv::transform([&symbols](auto s) noexcept { return symbols[s]; }) | stdr::to<std::string>()) << '\n';
+    }
+  }
+}
+
+auto HeadlessApp::operator()(std::span<const std::string_view> args) noexcept -> int {
+  auto modelarg = stdr::find_if(args, [](const auto& arg) static noexcept {
+    return stdr::cbegin(stdr::search(arg, "models/"s)) == stdr::cbegin(arg)
+       and arg.ends_with(".xml");
+  });
+  auto modelfile = std::filesystem::path{
+    modelarg != stdr::end(args) ? std::string{ *modelarg }
+                                : DEFAULT_MODEL_FILE
+  };
+
+  const auto seed = option(args, "--seed")
+    .transform(std::bind_back(number, "--seed"))
+    .value_or(std::random_device{}());
+  const auto extent = option(args, "--size")
+    .transform(extents)
+    .value_or(DEFAULT_GRID_EXTENT);
+  const auto count = option(args, "--count")
+    .transform(std::bind_back(number, "--count"))
+    .value_or(1u);
+  const auto threads = option(args, "--threads")
+    .transform(std::bind_back(number, "--threads"))
+    .value_or(std::max(std::thread::hardware_concurrency(), 1u));
+  const auto out = option(args, "--out").transform([](auto o) static noexcept {
+    return std::filesystem::path{ o };
+  });
+
+  stk::ensures(count == 1u or out.has_value(), std::format("'{}' above 1 needs '{}', every grid goes to its own file", "--count", "--out"));
+
+  /* consecutive seeds, one job each */
+  const auto jobs = stdv::iota(seed, seed + count)
+    | stdv::transform([&modelfile, extent](auto s) noexcept {
+        return Scheduler::Job{ modelfile, s, extent };
+    })
+    | stdr::to<std::vector>();
+
+  if (out and count > 1u) std::filesystem::create_directories(*out);
+
+  using ms = std::chrono::duration<double, std::milli>;
+  auto steps = 0uz;
+  auto scheduler = Scheduler{ std::min(threads, count) };
+
+  const auto start = clk::now();
+  scheduler.run(jobs, [&out, &steps, count](const Scheduler::Result& result) noexcept {
+    const auto& [index, job, progress, setup, run, grid, symbols] = result;
+    steps += progress.steps;
+
+    if (not out) write(std::cout, grid, symbols);
+    else {
+      /* several grids go to a directory, one file per seed */
+      const auto path = count == 1u ? *out : *out / std::format("{}_{}.txt", job.model.stem().string(), job.seed);
+      auto file = std::ofstream{ path };
+      write(file, grid, symbols);
+      stk::ensures(static_cast<bool>(file), std::format("failed to write '{}'", path.generic_string()));
+    }
+
+    std::println(
+      std::cerr, "{} seed {} : {} steps, setup {:.3f} ms, run {:.3f} ms",
+      job.model.generic_string(), job.seed, progress.steps, ms{ setup }.count(), ms{ run }.count()
+    );
+  });
+  const auto wall = ms{ clk::now() - start };
+
+  std::println(std::cerr, "size    {}x{}x{}", extent.extent(2), extent.extent(1), extent.extent(0));
+  std::println(std::cerr, "jobs    {} on {} threads", count, scheduler.size());
+  std::println(std::cerr, "wall    {:.3f} ms", wall.count());
+  std::println(std::cerr, "steps   {}", steps);
+  std::println(std::cerr, "rate    {:.0f} steps/s", wall.count() > 0.0 ? steps / wall.count() * 1000.0 : 0.0);
+
+  return 0;
+}
+
+auto BatchApp::operator()(std::span<const std::string_view> args) noexcept -> int {
+  auto entriesarg = stdr::find_if(args, [](const auto& arg) static noexcept {
+    return arg.ends_with("models.xml");
+  });
+  auto entriesfile =
+    entriesarg != stdr::end(args) ? std::string{ *entriesarg }
+                                  : DEFAULT_ENTRIES_FILE;
+
+  const auto seed = option(args, "--seed")
+    .transform(std::bind_back(number, "--seed"))
+    .value_or(std::random_device{}());
+  const auto threads = option(args, "--threads")
+    .transform(std::bind_back(number, "--threads"))
+    .value_or(std::max(std::thread::hardware_concurrency(), 1u));
+  const auto out = option(args, "--out").transform([](auto o) static noexcept {
+    return std::filesystem::path{ o };
+  });
+
+  /* entries differing only by their rendering settings run, or are reported skipped, once */
+  auto entries = std::vector<parser::Entry>{};
+  auto seen    = std::vector<parser::Entry>{};
+  for (auto&& entry : parser::Entries(parser::document(entriesfile))) {
+    if (stdr::find(seen, entry) != stdr::end(seen)) continue;
+    seen.push_back(entry);
+
+    const auto file = std::filesystem::path{ "models" } / (entry.name + ".xml");
+    if (not std::filesystem::exists(file)) {
+      std::println(std::cerr, "skipped {} : missing {}", entry.name, file.generic_string());
+      continue;
+    }
+    if (auto reason = parser::unsupported(parser::document(file).first_child())) {
+      std::println(std::cerr, "skipped {} : {}", entry.name, *reason);
+      continue;
+    }
+    entries.push_back(std::move(entry));
+  }
+
+  auto jobs  = std::vector<Scheduler::Job>{};
+  auto owner = std::vector<std::size_t>{};
+  for (const auto& [e, entry] : stdv::enumerate(entries)) {
+    for (auto a = 0uz; a < entry.amount; ++a) {
+      jobs.push_back({
+        std::filesystem::path{ "models" } / (entry.name + ".xml"),
+        seed + stdr::size(jobs),
+        entry.extents,
+        entry.steps
+      });
+      owner.push_back(static_cast<std::size_t>(e));
+    }
+  }
+
+  if (out) std::filesystem::create_directories(*out);
+
+  /* entries are timed from the start of their first job to the completion of their last one */
+  struct Summary {
+    std::uint64_t   steps = 0;
+    std::size_t     runs  = 0;
+    clk::time_point first = clk::time_point::max();
+    clk::time_point last  = clk::time_point::min();
+  };
+  auto summaries = std::vector<Summary>(stdr::size(entries));
+
+  auto scheduler = Scheduler{ threads };
+
+  const auto start = clk::now();
+  scheduler.run(jobs, [&owner, &summaries, &out](const Scheduler::Result& result) noexcept {
+    const auto& [index, job, progress, setup, run, grid, symbols] = result;
+
+    const auto now = clk::now();
+    auto& summary = summaries[owner[index]];
+    summary.steps += progress.steps;
+    summary.runs  += 1u;
+    summary.first  = std::min(summary.first, now - std::chrono::duration_cast<clk::duration>(setup + run));
+    summary.last   = now;
+
+    if (out) {
+      const auto path = *out / std::format("{}_{}.txt", job.model.stem().string(), job.seed);
+      auto file = std::ofstream{ path };
+      write(file, grid, symbols);
+      stk::ensures(static_cast<bool>(file), std::format("failed to write '{}'", path.generic_string()));
+    }
+  });
+
+  using ms = std::chrono::duration<double, std::milli>;
+  const auto wall = ms{ clk::now() - start };
+
+  std::println("{:<28} {:>14} {:>6} {:>10} {:>12} {:>12}", "model", "size", "runs", "steps", "wall ms", "steps/s");
+  for (const auto& [entry, summary] : stdv::zip(entries, summaries)) {
+    const auto elapsed = summary.runs > 0u ? ms{ summary.last - summary.first } : ms{};
+    std::println(
+      "{:<28} {:>14} {:>6} {:>10} {:>12.3f} {:>12.0f}",
+      entry.name,
+      std::format("{}x{}x{}", entry.extents.extent(2), entry.extents.extent(1), entry.extents.extent(0)),
+      summary.runs, summary.steps, elapsed.count(),
+      elapsed.count() > 0.0 ? summary.steps / elapsed.count() * 1000.0 : 0.0
+    );
+  }
+
+  const auto steps = stdr::fold_left(summaries | stdv::transform(&Summary::steps), std::uint64_t{ 0 }, std::plus{});
+  std::println(
+    "{:<28} {:>14} {:>6} {:>10} {:>12.3f} {:>12.0f}",
+    "total", std::format("{} threads", scheduler.size()), stdr::size(jobs), steps, wall.count(),
+    wall.count() > 0.0 ? steps / wall.count() * 1000.0 : 0.0
+  );
+
+  return 0;
+}
@@ -0,0 +1,82 @@
+module headless.scheduler;
+
+import engine.aot;
+import workers;
+
+namespace stdr = std::ranges;
+
+using clk = std::chrono::steady_clock;
+
+Scheduler::Instance::Instance(Model&& _model) noexcept
+: model{std::move(_model)},
+  grid{},
+  interpreter{model.program, grid}
+{}
+
+Scheduler::Scheduler(std::size_t threads) noexcept
+: workers(std::max(threads, 1uz))
+{}
+
+auto Scheduler::size() const noexcept -> std::size_t {
+  return stdr::size(workers);
+}
+
+/** Own jobs are taken from the front, stolen ones from the back of the victim queue */
+auto Scheduler::next(std::size_t w) noexcept -> std::optional<std::size_t> {
+  const auto n = stdr::size(workers);
+  for (auto k = 0uz; k < n; ++k) {
+    auto& victim = workers[(w + k) % n];
+    auto l = std::lock_guard{ victim.m };
+    if (stdr::empty(victim.queue)) continue;
+
+    auto job = k == 0u ? victim.queue.front() : victim.queue.back();
+    if (k == 0u) victim.queue.pop_front();
+    else         victim.queue.pop_back();
+    return job;
+  }
+  return std::nullopt;
+}
+
+auto Scheduler::instance(Worker& worker, const std::filesystem::path& model) noexcept -> Instance& {
+  auto key = model.generic_string();
+  if (auto it = worker.instances.find(key); it != stdr::end(worker.instances)) return it->second;
+  return worker.instances.try_emplace(std::move(key), aot::load(model)).first->second;
+}
+
+auto Scheduler::run(std::span<const Job> jobs, const Sink& sink) noexcept -> void {
+  for (auto i = 0uz; i < stdr::size(jobs); ++i) {
+    workers[i % stdr::size(workers)].queue.push_back(i);
+  }
+
+  auto sink_m = std::mutex{};
+  const auto work = [this, jobs, &sink, &sink_m](std::size_t w) noexcept {
+    /* the scheduler threads already keep the cores busy, the loops of a run stay on its thread */
+    auto serial = std::optional<Workers::Inline>{};
+    if (size() > 1u) serial.emplace();
+
+    auto& worker = workers[w];
+    while (auto i = next(w)) {
+      const auto& job = jobs[*i];
+      const auto start = clk::now();
+
+      auto& [model, grid, interpreter] = instance(worker, job.model);
+      interpreter.reset();
+      reseed(model.program, job.seed);
+      grid.reset(job.extents, symbol{ 0 });
+      if (model.origin) grid.set(grid.area().center(), symbol{ 1 });
+
+      const auto loaded   = clk::now();
+      const auto progress = job.steps > 0u ? interpreter.run(job.steps) : interpreter.run_until_halt();
+      const auto done     = clk::now();
+
+      auto l = std::lock_guard{ sink_m };
+      sink({ *i, job, progress, loaded - start, done - loaded, grid, model.symbols });
+    }
+  };
+
+  {
+    auto threads = std::vector<std::jthread>{};
+    for (auto w = 1uz; w < stdr::size(workers); ++w) threads.emplace_back(work, w);
+    work(0uz);
+  }
+}
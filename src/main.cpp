@@ -5,6 +5,7 @@ import stormkit.log;
 import stormkit.core;
 import tui.consoleapp;
 import gui.windowapp;
+import headless.headlessapp;
 
 namespace stk = stormkit;
 
@@ -18,6 +19,16 @@ constexpr auto run_windowapp(std::span<const std::string_view> args) noexcept ->
   return app(args);
 }
 
+constexpr auto run_headlessapp(std::span<const std::string_view> args) noexcept -> int {
+  auto app = HeadlessApp{};
+  return app(args);
+}
+
+constexpr auto run_batchapp(std::span<const std::string_view> args) noexcept -> int {
+  auto app = BatchApp{};
+  return app(args);
+}
+
 auto main(const int argc, const char** argv) -> int {
   // [tmpfix] remove when xmake target properly handles workdir on macos
   // chdir("/Users/mtrimolet/Desktop/mtrimolet/markovjunior");
@@ -29,9 +40,13 @@ auto main(const int argc, const char** argv) -> int {
   for (auto i = 0u; i < static_cast<std::size_t>(argc); ++i) args.emplace_back(argv[i]);
 
   auto&& gui = std::ranges::find(args, "--gui") != std::ranges::end(args);
+  auto&& headless = std::ranges::find(args, "--headless") != std::ranges::end(args);
+  auto&& batch = std::ranges::find(args, "--batch") != std::ranges::end(args);
   
   auto _ = stk::log::Logger::create_logger_instance<stk::log::FileLogger>(".");
 
-  if (gui) return run_windowapp(args);
-  else     return run_consoleapp(args);
+  if (batch)    return run_batchapp(args);
+  if (headless) return run_headlessapp(args);
+  if (gui)      return run_windowapp(args);
+  else          return run_consoleapp(args);
 }
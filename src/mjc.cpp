@@ -0,0 +1,32 @@
+import std;
+import stormkit.core;
+import parser;
+import compiler.emitter;
+
+namespace stk = stormkit;
+
+/** Bakes a model into a C++ translation unit : mjc <model.xml> <output.cpp> */
+auto main(const int argc, const char** argv) -> int {
+  stk::setup_signal_handler();
+
+  auto args = std::vector<std::string_view> {};
+  for (auto i = 0u; i < static_cast<std::size_t>(argc); ++i) args.emplace_back(argv[i]);
+
+  if (std::ranges::size(args) != 3u) {
+    std::println(std::cerr, "usage: {} <model.xml> <output.cpp>", args[0]);
+    return 1;
+  }
+
+  const auto source   = std::filesystem::path{ args[1] };
+  const auto document = parser::document(source);
+  const auto model    = parser::Model(document);
+
+  /* the model seed only stands for the attribute, a model without one being seeded at random */
+  const auto xseed = document.first_child().attribute("seed");
+  const auto seed  = xseed ? std::optional{ static_cast<std::uint64_t>(xseed.as_ullong()) } : std::nullopt;
+
+  auto out = std::ofstream{ std::filesystem::path{ args[2] } };
+  out << compiler::emit(model, source.stem().string(), source.generic_string(), seed);
+
+  return out ? 0 : 1;
+}
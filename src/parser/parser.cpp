@@ -50,32 +50,68 @@ auto get_char(const pugi::xml_node& xnode, auto name) -> char {
   return result[0];
 }
 
-auto get_optchar(const pugi::xml_node& xnode, auto name) -> std::optional<char> {
-  return xnode.attribute(name) ? std::optional{ get_char(xnode, name) } : std::nullopt;
-}
-
-auto get_charset(const pugi::xml_node& xnode, auto name) -> std::unordered_set<char> {
+auto get_charset(const pugi::xml_node& xnode, auto name, const RewriteRule::Unions& unions) -> charset {
   auto result_str = get_string(xnode, name);
-  auto result = result_str | stdr::to<std::unordered_set>();
 
   stk::ensures(
-    stdr::size(result) == stdr::size(result_str),
+    stdr::size(result_str | stdr::to<std::unordered_set>()) == stdr::size(result_str),
     std::format("duplicate value in '{}' attribute of '{}' node [:{}]",
                 name, xnode.name(), xnode.offset_debug())
   );
 
-  return result;
+  return stdr::fold_left(
+    result_str | stdv::transform([&xnode, &name, &unions](auto c) noexcept {
+      stk::ensures(
+        unions.contains(c),
+        std::format("unknown symbol '{}' in '{}' attribute of '{}' node [:{}]",
+                    c, name, xnode.name(), xnode.offset_debug())
+      );
+      return unions.at(c);
+    }),
+    charset{}, std::bit_or{}
+  );
 }
 
-auto Model(const pugi::xml_document& xmodel) noexcept -> ::Model {
+auto get_symbol(const pugi::xml_node& xnode, auto name, const RewriteRule::Unions& unions) -> symbol {
+  auto result = get_charset(xnode, name, unions);
+
+  stk::ensures(
+    stdr::size(result) == 1u,
+    std::format("only one symbol allowed for '{}' attribute of '{}' node [:{}]",
+                name, xnode.name(), xnode.offset_debug())
+  );
+
+  return *stdr::begin(result);
+}
+
+auto get_optsymbol(const pugi::xml_node& xnode, auto name, const RewriteRule::Unions& unions) -> std::optional<symbol> {
+  return xnode.attribute(name) ? std::optional{ get_symbol(xnode, name, unions) } : std::nullopt;
+}
+
+auto Model(const pugi::xml_document& xmodel, std::optional<std::uint64_t> seed) noexcept -> ::Model {
   const auto& xnode = xmodel.first_child();
 
   auto symbols = get_string(xnode, "values");
 
+  stk::ensures(
+    stdr::size(symbols) <= charset::CAPACITY,
+    std::format("too many symbols in '{}' attribute of '{}' node, at most {} allowed [:{}]",
+                "values", xnode.name(), charset::CAPACITY, xnode.offset_debug())
+  );
+  stk::ensures(
+    stdr::size(symbols | stdr::to<std::unordered_set>()) == stdr::size(symbols),
+    std::format("duplicate value in '{}' attribute of '{}' node [:{}]",
+                "values", xnode.name(), xnode.offset_debug())
+  );
+
+  auto ids = stdv::iota(0uz, stdr::size(symbols))
+    | stdv::transform([](auto i) static noexcept { return static_cast<symbol>(i); });
+
   auto unions = RewriteRule::Unions{};
-  unions.emplace(RewriteRule::IGNORED_SYMBOL, symbols | stdr::to<std::unordered_set>());
-  unions.insert_range(symbols | stdv::transform([](auto c) static noexcept { 
-    return std::pair{ c, std::unordered_set{ c } };
+  unions.emplace(RewriteRule::IGNORED_SYMBOL, charset{ std::from_range, ids });
+  unions.insert_range(stdv::zip(symbols, ids) | stdv::transform([](auto&& ci) static noexcept {
+    auto [c, i] = ci;
+    return std::pair{ c, charset{ i } };
   }));
 
   auto program = NodeRunner(xnode, unions);
@@ -87,20 +123,30 @@ auto Model(const pugi::xml_document& xmodel) noexcept -> ::Model {
     program = TreeRunner{ TreeRunner::Mode::MARKOV, std::move(nodes) };
   }
 
+  const auto s = seed.value_or(
+    xnode.attribute("seed") ? xnode.attribute("seed").as_ullong() : std::random_device{}()
+  );
+  reseed(program, s);
+
+  auto fields = std::make_shared<Field::Store>();
+  share(program, fields);
+
   return ::Model{
     // title,
     std::string{ symbols },
     std::move(unions),
     xnode.attribute("origin").as_bool(false),
-    std::move(program)
+    std::move(program),
+    s,
+    std::move(fields)
   };
 }
 
-auto Union(const pugi::xml_node& xnode) noexcept -> decltype(auto) {
-  auto symbol = get_char(xnode, "symbol");
-  auto values = get_charset(xnode, "values");
+auto Union(const pugi::xml_node& xnode, const RewriteRule::Unions& unions) noexcept -> decltype(auto) {
+  auto character = get_char(xnode, "symbol");
+  auto values    = get_charset(xnode, "values", unions);
 
-  return std::tuple{ symbol, std::move(values) };
+  return std::pair{ character, std::move(values) };
 }
 
 auto NodeRunner(
@@ -110,7 +156,9 @@ auto NodeRunner(
 ) noexcept -> ::NodeRunner {
   symmetry = xnode.attribute("symmetry").as_string(std::data(symmetry));
 
-  unions.insert_range(xnode.children("union") | stdv::transform(Union));
+  for (const auto& xunion : xnode.children("union")) {
+    unions.insert(Union(xunion, unions));
+  }
 
   const auto& tag = xnode.name();
   if (tag == "sequence"s
@@ -157,7 +205,7 @@ auto RuleNode(
     return ::RuleNode{
       mode, Rules(xnode, unions, symmetry),
       std::move(unions),
-      Observes(xnode),
+      Observes(xnode, unions),
       xnode.attribute("limit").as_uint(0),
       xnode.attribute("depthCoefficient").as_double(0.5)
     };
@@ -167,7 +215,7 @@ auto RuleNode(
     return ::RuleNode{
       mode, Rules(xnode, unions, symmetry),
       std::move(unions),
-      Observes(xnode),
+      Observes(xnode, unions),
       xnode.attribute("temperature").as_double(0.0)
     };
   }
@@ -176,7 +224,7 @@ auto RuleNode(
     return ::RuleNode{
       mode, Rules(xnode, unions, symmetry),
       std::move(unions),
-      Fields(xnode),
+      Fields(xnode, unions),
       xnode.attribute("temperature").as_double(0.0)
     };
   }
@@ -228,9 +276,9 @@ auto Rules(
   };
 }
 
-auto Field(const pugi::xml_node& xnode) noexcept -> std::pair<char, ::Field> {
-  auto _for = get_char(xnode, "for");
-  auto substrate = get_charset(xnode, "on");
+auto Field(const pugi::xml_node& xnode, const RewriteRule::Unions& unions) noexcept -> std::pair<symbol, ::Field> {
+  auto _for = get_symbol(xnode, "for", unions);
+  auto substrate = get_charset(xnode, "on", unions);
 
   stk::ensures(
     xnode.attribute("from") or xnode.attribute("to"),
@@ -244,7 +292,7 @@ auto Field(const pugi::xml_node& xnode) noexcept -> std::pair<char, ::Field> {
   );
 
   auto inversed = not xnode.attribute("to");
-  auto zero = inversed ? get_charset(xnode, "from") : get_charset(xnode, "to");
+  auto zero = get_charset(xnode, inversed ? "from" : "to", unions);
 
   return std::pair{
     _for,
@@ -256,27 +304,81 @@ auto Field(const pugi::xml_node& xnode) noexcept -> std::pair<char, ::Field> {
   };
 }
 
-auto Fields(const pugi::xml_node& xnode) noexcept -> ::Fields {
+auto Fields(const pugi::xml_node& xnode, const RewriteRule::Unions& unions) noexcept -> ::Fields {
   return xnode.children("field")
-    | stdv::transform(Field)
+    | stdv::transform(std::bind_back(Field, std::cref(unions)))
     | stdr::to<::Fields>();
 }
 
-auto Observe(const pugi::xml_node& xnode) noexcept -> std::pair<char, ::Observe> {
-  auto value = get_char(xnode, "value");
-  auto from  = get_optchar(xnode, "from");
+auto Observe(const pugi::xml_node& xnode, const RewriteRule::Unions& unions) noexcept -> std::pair<symbol, ::Observe> {
+  auto value = get_symbol(xnode, "value", unions);
+  auto from  = get_optsymbol(xnode, "from", unions);
 
   return std::pair{
     value,
     ::Observe{
       from,
-      get_charset(xnode, "to")
+      get_charset(xnode, "to", unions)
     }
   };
 }
 
-auto Observes(const pugi::xml_node& xnode) noexcept -> ::Observes {
-  return { std::from_range, xnode.children("observe") | stdv::transform(Observe) };
+auto Observes(const pugi::xml_node& xnode, const RewriteRule::Unions& unions) noexcept -> ::Observes {
+  return {
+    std::from_range,
+    xnode.children("observe") | stdv::transform(std::bind_back(Observe, std::cref(unions)))
+  };
+}
+
+auto unsupported(const pugi::xml_node& xnode) noexcept -> std::optional<std::string> {
+  static constexpr auto TAGS = std::array{
+    "sequence"sv, "markov"sv,
+    "one"sv, "all"sv, "prl"sv,
+    "rule"sv, "union"sv, "field"sv, "observe"sv,
+  };
+
+  if (stdr::find(TAGS, std::string_view{ xnode.name() }) == stdr::end(TAGS)) {
+    return std::format("unsupported tag '{}' [:{}]", xnode.name(), xnode.offset_debug());
+  }
+  if (xnode.attribute("file")) {
+    return std::format("unsupported '{}' attribute in '{}' node [:{}]",
+                       "file", xnode.name(), xnode.offset_debug());
+  }
+
+  for (const auto& xchild : xnode.children()) {
+    if (xchild.type() != pugi::node_element) continue;
+    if (auto reason = unsupported(xchild)) return reason;
+  }
+  return std::nullopt;
+}
+
+auto Entries(const pugi::xml_document& xentries) noexcept -> std::vector<Entry> {
+  return xentries.child("models").children("model")
+    /* same defaults as the reference implementation : 2D grids, 50000 steps at most, two runs */
+    | stdv::transform([](const auto& xnode) static noexcept {
+        auto size      = xnode.attribute("size").as_uint(0);
+        auto dimension = xnode.attribute("d").as_uint(2);
+
+        auto x = xnode.attribute("length").as_uint(size);
+        auto y = xnode.attribute("width").as_uint(size);
+        auto z = xnode.attribute("height").as_uint(dimension == 2u ? 1u : size);
+
+        stk::ensures(
+          x > 0u and y > 0u and z > 0u,
+          std::format("missing '{}' attribute in '{}' node [:{}]",
+                      "size", xnode.name(), xnode.offset_debug())
+        );
+
+        auto steps = xnode.attribute("steps").as_llong(50000);
+
+        return Entry{
+          std::string{ get_string(xnode, "name") },
+          std::dims<3>{ z, y, x },
+          steps > 0 ? static_cast<std::uint64_t>(steps) : 0u,
+          xnode.attribute("amount").as_ullong(2u),
+        };
+    })
+    | stdr::to<std::vector>();
 }
 
 auto Palette(const pugi::xml_document& xpalette) noexcept -> ColorPalette {
@@ -284,7 +386,7 @@ auto Palette(const pugi::xml_document& xpalette) noexcept -> ColorPalette {
     std::from_range,
     xpalette.child("colors").children("color")
       | stdv::transform([](const auto& xcolor) static noexcept {
-          auto symbol = get_char(xcolor, "symbol");
+          auto character = get_char(xcolor, "symbol");
           auto value  = get_string(xcolor, "value");
         
           stk::ensures(
@@ -293,7 +395,7 @@ auto Palette(const pugi::xml_document& xpalette) noexcept -> ColorPalette {
                         "value", "color", xcolor.offset_debug())
           );
         
-          return std::tuple{ symbol, Color{
+          return std::tuple{ character, Color{
             fromBase<stk::u8>({ stdr::cbegin(value),     stdr::cbegin(value) + 2 }, 16),
             fromBase<stk::u8>({ stdr::cbegin(value) + 2, stdr::cbegin(value) + 4 }, 16),
             fromBase<stk::u8>({ stdr::cbegin(value) + 4, stdr::cend(value)       }, 16),
@@ -0,0 +1,77 @@
+module potentials;
+
+namespace stdr = std::ranges;
+namespace stdv = std::views;
+
+auto Potentials::relayout(std::vector<symbol> next) noexcept -> void {
+  const auto count = stdr::size(next);
+
+  auto moved = std::vector<Distance>(cells * count, UNSET);
+  for (auto [s, c] : stdv::enumerate(next)) {
+    if (not contains(c)) continue;
+    for (auto i = 0uz; i < cells; ++i) {
+      const auto to = layout == Layout::PLANAR ? static_cast<std::size_t>(s) * cells + i
+                                               : i * count + static_cast<std::size_t>(s);
+      moved[to] = values[index(c, i)];
+    }
+  }
+
+  slots.fill(NO_SLOT);
+  for (auto [s, c] : stdv::enumerate(next)) slots[c] = static_cast<stk::u16>(s);
+  planes = std::move(next);
+  values = std::move(moved);
+}
+
+auto Potentials::emplace(symbol c, std::dims<3> _extents, bool _negated) noexcept -> void {
+  if (stdr::empty(planes)) {
+    extents = _extents;
+    cells   = extents.extent(0) * extents.extent(1) * extents.extent(2);
+  }
+
+  if (_negated) negated.insert(c);
+  else          negated.erase(c);
+
+  if (contains(c)) return;
+
+  /* planes follow one another, a new one just goes at the end */
+  if (layout == Layout::PLANAR) {
+    slots[c] = static_cast<stk::u16>(stdr::size(planes));
+    planes.push_back(c);
+    values.resize(cells * stdr::size(planes), UNSET);
+    return;
+  }
+
+  auto next = planes;
+  next.push_back(c);
+  relayout(std::move(next));
+}
+
+auto Potentials::erase(symbol c) noexcept -> void {
+  if (not contains(c)) return;
+
+  negated.erase(c);
+  relayout(planes
+    | stdv::filter([c](auto p) noexcept { return p != c; })
+    | stdr::to<std::vector>()
+  );
+}
+
+auto Potentials::clear() noexcept -> void {
+  slots.fill(NO_SLOT);
+  negated = {};
+  planes.clear();
+  values.clear();
+  cells = 0;
+}
+
+auto Potentials::unset() noexcept -> void {
+  stdr::fill(values, UNSET);
+}
+
+auto Potentials::plane(symbol c) const noexcept -> Potential {
+  auto potential = Potential{ extents, std::numeric_limits<double>::quiet_NaN() };
+  if (not contains(c)) return potential;
+
+  for (auto i = 0uz; i < cells; ++i) potential.values[i] = at(c, i);
+  return potential;
+}
@@ -0,0 +1,203 @@
+import std;
+import stormkit.core;
+import geometry;
+
+import grid;
+import charset;
+import parser;
+import engine.model;
+import engine.rulenode;
+import engine.rewriterule;
+import engine.match;
+import engine.bitplanes;
+import engine.matcher;
+import engine.fields;
+
+namespace stk  = stormkit;
+namespace stdr = std::ranges;
+namespace stdv = std::views;
+
+using Rng = std::mt19937_64;
+
+/** Grids of every shape the kernels tell apart : narrower than a word, over several words, flat and deep */
+static constexpr auto EXTENTS = std::array{
+  std::dims<3>{ 1u, 5u, 9u },
+  std::dims<3>{ 1u, 13u, 70u },
+  std::dims<3>{ 1u, 3u, 130u },
+  std::dims<3>{ 3u, 7u, 67u },
+};
+
+static constexpr auto GRIDS_PER_NODE = 3uz;
+static constexpr auto EDITS          = 24uz;
+
+struct Failures {
+  std::size_t checks = 0;
+  std::size_t count  = 0;
+
+  auto check(bool ok, std::string_view what) noexcept -> void {
+    ++checks;
+    if (ok) return;
+    if (++count <= 20u) std::println(std::cerr, "mismatch : {}", what);
+  }
+};
+
+/** Axes as the headless app prints them, x first */
+static auto shape(std::dims<3> extents) noexcept -> std::string {
+  return std::format("{}x{}x{}", extents.extent(2), extents.extent(1), extents.extent(0));
+}
+
+/** Mostly the first symbol, so that rules find enough matches to compare */
+auto random_grid(Rng& rng, std::dims<3> extents, std::size_t symbols) noexcept -> TracedGrid<symbol> {
+  auto grid = TracedGrid<symbol>{ extents, symbol{ 0 } };
+  auto pick = std::uniform_int_distribution<std::size_t>{ 0u, symbols - 1u };
+  auto bias = std::bernoulli_distribution{ 0.4 };
+  for (auto u : mdiota(grid.area())) {
+    grid.set(u, bias(rng) ? symbol{ 0 } : static_cast<symbol>(pick(rng)));
+  }
+  return grid;
+}
+
+auto random_change(Rng& rng, const Grid<symbol>& grid, std::size_t symbols) noexcept -> Change<symbol> {
+  const auto size = fromExtents(grid.extents);
+  auto along = [&rng](std::size_t n) noexcept { return std::uniform_int_distribution<std::size_t>{ 0u, n - 1u }(rng); };
+  return { { along(size.x), along(size.y), along(size.z) }, static_cast<symbol>(along(symbols)) };
+}
+
+/** Matches as (rule, anchor index), in a canonical order */
+auto keys(std::span<const Match> matches, const Grid<symbol>& grid) noexcept -> std::vector<std::pair<stk::ioffset, std::size_t>> {
+  auto result = matches
+    | stdv::transform([&grid](const auto& m) noexcept {
+        return std::pair{ m.r, static_cast<std::size_t>(toIndex(m.u, grid.extents)) };
+    })
+    | stdr::to<std::vector>();
+  stdr::sort(result);
+  return result;
+}
+
+auto covers(const Match& match, std::span<const Change<symbol>> changes) noexcept -> bool {
+  const auto area = match.rules[match.r].input.area() + match.u;
+  return stdr::any_of(changes, [&area](const auto& change) noexcept { return area.contains(change.u); });
+}
+
+/** Every found match holds, and every match over a changed cell is found */
+auto check_incremental(
+  Failures& failures,
+  std::string_view what,
+  std::span<const Match> found,
+  std::span<const Match> expected,
+  const Grid<symbol>& grid
+) noexcept -> void {
+  failures.check(stdr::all_of(found, [&grid](const auto& m) noexcept { return m.match(grid); }), std::format("{} : stale match", what));
+
+  const auto keys_found = keys(found, grid);
+  failures.check(
+    stdr::all_of(keys(expected, grid), [&keys_found](const auto& k) noexcept { return stdr::binary_search(keys_found, k); }),
+    std::format("{} : missed match", what)
+  );
+}
+
+/** Bit-plane and decision tree scans against the cell by cell scan, full and after edits */
+auto check_scans(Failures& failures, Rng& rng, const RuleNode& node, std::size_t symbols, std::string_view model) noexcept -> void {
+  const auto rules   = std::span{ node.rules };
+  const auto matcher = Matcher::compile(rules);
+
+  for (const auto& extents : EXTENTS) {
+    for (auto k = 0uz; k < GRIDS_PER_NODE; ++k) {
+      auto grid = random_grid(rng, extents, symbols);
+      const auto what = std::format("{} {}", model, shape(extents));
+
+      const auto lattice = keys(Match::scan_lattice(grid, rules), grid);
+      if (stdr::size(grid.values()) >= BitPlanes::WORD_BITS) {
+        failures.check(keys(BitPlanes{ grid }.scan(rules), grid) == lattice, std::format("{} : bit planes", what));
+      }
+      if (matcher) failures.check(keys(matcher->scan(grid, rules), grid) == lattice, std::format("{} : matcher", what));
+
+      const auto first = stdr::size(grid.history());
+      for (auto e = 0uz; e < EDITS; ++e) grid.apply(random_change(rng, grid, symbols));
+      const auto changes = grid.history().subspan(first);
+
+      auto expected = Match::scan_lattice(grid, rules);
+      std::erase_if(expected, [changes](const auto& m) noexcept { return not covers(m, changes); });
+
+      auto anchors = Stamps{};
+      check_incremental(failures, std::format("{} : incremental scan", what), Match::scan(grid, rules, changes, anchors), expected, grid);
+      if (matcher) {
+        check_incremental(failures, std::format("{} : incremental matcher", what), matcher->scan(grid, rules, dirty_boxes(changes), anchors), expected, grid);
+      }
+    }
+  }
+}
+
+/** Fields brought up to date through repairs against fields computed anew */
+auto check_fields(Failures& failures, Rng& rng, std::size_t symbols) noexcept -> void {
+  auto subset = [&rng, symbols] noexcept {
+    auto values = charset{};
+    auto keep   = std::bernoulli_distribution{ 0.5 };
+    for (auto c = 0uz; c < symbols; ++c) if (keep(rng)) values.insert(static_cast<symbol>(c));
+    return values;
+  };
+
+  for (const auto& extents : EXTENTS) {
+    auto grid  = random_grid(rng, extents, symbols);
+    auto field = Field{ true, false, false, subset() | charset{ 0 }, subset() };
+    auto shared = Field::Shared{};
+    field.refresh(grid, shared);
+
+    /* edit rounds from a single cell to past the share a repair gives up at */
+    for (auto round = 0uz; round < 64u; ++round) {
+      const auto edits = 1uz << (round % 8u);
+      for (auto e = 0uz; e < edits; ++e) grid.apply(random_change(rng, grid, symbols));
+      field.refresh(grid, shared);
+
+      auto fresh = Field::Distances{};
+      field.compute(grid, fresh);
+      failures.check(
+        shared.distances.values == fresh.values and shared.distances.reached == fresh.reached,
+        std::format("field {} round {} ({} edits)", shape(extents), round, edits)
+      );
+    }
+  }
+}
+
+auto each_rulenode(const NodeRunner& runner, auto&& f) noexcept -> void {
+  if (const auto p = std::get_if<TreeRunner>(&runner); p != nullptr) {
+    for (const auto& node : p->nodes) each_rulenode(node, f);
+    return;
+  }
+  f(std::get<RuleRunner>(runner).rulenode);
+}
+
+/** Differential checks of the scan kernels and the field repairs on the bundled models : selftest [models directory] */
+auto main(const int argc, const char** argv) -> int {
+  stk::setup_signal_handler();
+
+  const auto directory = std::filesystem::path{ argc > 1 ? argv[1] : "models" };
+
+  auto files = std::filesystem::directory_iterator{ directory }
+    | stdv::transform([](const auto& entry) static noexcept { return entry.path(); })
+    | stdv::filter([](const auto& path) static noexcept { return path.extension() == ".xml"; })
+    | stdr::to<std::vector>();
+  stdr::sort(files);
+
+  auto rng      = Rng{ 0x5eed };
+  auto failures = Failures{};
+  auto models   = 0uz;
+
+  for (const auto& file : files) {
+    const auto document = parser::document(file);
+    if (parser::unsupported(document.first_child())) continue;
+
+    const auto model   = parser::Model(document);
+    const auto symbols = std::max(stdr::size(model.symbols), 1uz);
+    const auto name    = file.stem().string();
+
+    each_rulenode(model.program, [&failures, &rng, symbols, &name](const RuleNode& node) noexcept {
+      check_scans(failures, rng, node, symbols, name);
+    });
+    check_fields(failures, rng, symbols);
+    ++models;
+  }
+
+  std::println("{} models, {} checks, {} mismatches", models, failures.checks, failures.count);
+  return failures.count == 0u ? 0 : 1;
+}
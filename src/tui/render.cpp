@@ -26,32 +26,31 @@ Decorator window_wrap(std::string title) {
   };
 }
 
-Element block_symbol(char c, const Palette& palette) noexcept {
-  auto col = palette.contains(c) ? palette.at(c) : Color::Default;
+Element block_symbol(symbol c, const Palette& palette) noexcept {
+  auto col = std::get<1>(palette.at(c));
   return text("  ") | color(col) | inverted;
 }
 
-Element named_symbol(char c, const Palette& palette) noexcept {
-  auto col = palette.contains(c) ? palette.at(c) : Color::Default;
-  return text(std::string{ c }) | color(col) | inverted;
+Element named_symbol(symbol c, const Palette& palette) noexcept {
+  const auto& [character, col] = palette.at(c);
+  return text(std::string{ character }) | color(col) | inverted;
 }
 
 Element symbolset(charset s, const Palette& palette) noexcept {
   return hbox({ std::from_range, s | stdv::transform(std::bind_back(named_symbol, palette)) });
 }
 
-Element grid(const Grid<char>& g, const Palette& palette) noexcept {
+Element grid(const Grid<symbol>& g, const Palette& palette) noexcept {
   auto texture = Image{
     static_cast<int>(g.extents.extent(2)) * 2,
     static_cast<int>(g.extents.extent(1))
   };
   stdr::for_each(
     stdv::zip(mdiota(g.area()), g),
-    [&](auto u_char) noexcept {
-      auto [u, character] = u_char;
-      
-      auto b = palette.contains(character) ? palette.at(character)
-                                           : Color::Default;
+    [&](auto u_symbol) noexcept {
+      auto [u, s] = u_symbol;
+
+      auto b = std::get<1>(palette.at(s));
       auto& pixel0 = texture.PixelAt(u.x * 2, u.y);
       pixel0.character        = ' ';
       pixel0.background_color = b;
@@ -81,31 +80,23 @@ Element rule(const RewriteRule& rule, const Palette& palette) noexcept {
     [&input, &output, &palette](auto uio) noexcept {
       auto [u, i, o] = uio;
 
-      auto ib = i and palette.contains(*i->begin()) ? palette.at(*i->begin())
-                                                    : Color{ Color::Default };
+      auto ib = i ? std::get<1>(palette.at(*i->begin()))
+                  : Color{ Color::Default };
 
       auto& ip0 = input.PixelAt(u.x * 2, u.y);
-      ip0.character        = not i                         ? '>'
-                           : palette.contains(*i->begin()) ? ' '
-                                                           : '?';
+      ip0.character        = not i ? '>' : ' ';
       ip0.background_color = ib;
       auto& ip1 = input.PixelAt(u.x * 2 + 1, u.y);
-      ip1.character        = not i                         ? '<'
-                           : palette.contains(*i->begin()) ? ' '
-                                                           : '?';
+      ip1.character        = not i ? '<' : ' ';
       ip1.background_color = ib;
 
-      auto ob = o and palette.contains(*o) ? palette.at(*o)
-                                           : Color{ Color::Default };
+      auto ob = o ? std::get<1>(palette.at(*o))
+                  : Color{ Color::Default };
       auto& op0 = output.PixelAt(u.x * 2, u.y);
-      op0.character        = not o                ? '>'
-                           : palette.contains(*o) ? ' '
-                                                  : '?';
+      op0.character        = not o ? '>' : ' ';
       op0.background_color = ob;
       auto& op1 = output.PixelAt(u.x * 2 + 1, u.y);
-      op1.character        = not o                ? '<'
-                           : palette.contains(*o) ? ' '
-                                                  : *o;
+      op1.character        = not o ? '<' : ' ';
       op1.background_color = ob;
     }
   );
@@ -178,7 +169,7 @@ Element potential(const Potential& g) noexcept {
     | size(HEIGHT, EQUAL, h);
 }
 
-Element potential(char c, const Potential& pot, const Palette& palette) noexcept {
+Element potential(symbol c, const Potential& pot, const Palette& palette) noexcept {
   return window(named_symbol(c, palette), potential(pot));
 }
 
@@ -281,15 +272,15 @@ Element nodeRunner(const NodeRunner& node, const Palette& palette, bool selected
 Element symbols(std::string_view values, const Palette& palette) noexcept {
   auto texture = Image{ 8 * 2, 1 + static_cast<int>(stdr::size(values)) / 8 };
   stdr::for_each(
-    stdv::zip(values, mdiota(Area3{ {}, { texture.dimx() / 2, texture.dimy(), 1 } })),
-    [&](auto&& cu) noexcept {
-      auto [character, u] = cu;
+    stdv::zip(values, palette, mdiota(Area3{ {}, { texture.dimx() / 2, texture.dimy(), 1 } })),
+    [&](auto&& ccu) noexcept {
+      auto [character, s, u] = ccu;
       auto& pixel0 = texture.PixelAt(u.x * 2, u.y);
       pixel0.character        = character;
-      pixel0.background_color = palette.at(character);
+      pixel0.background_color = std::get<1>(s);
       auto& pixel1 = texture.PixelAt(u.x * 2 + 1, u.y);
       pixel1.character        = " ";
-      pixel1.background_color = palette.at(character);
+      pixel1.background_color = std::get<1>(s);
     }
   );
 
@@ -346,7 +337,7 @@ struct GridScroll {
   T y;
 };
 
-Component WorldAndPotentials(const Grid<char>& grid, const Model& model, const render::Palette& palette) {
+Component WorldAndPotentials(const Grid<symbol>& grid, const Model& model, const render::Palette& palette) {
   struct Impl : ComponentBase {
     const Model& model;
     const render::Palette& palette;
@@ -358,7 +349,7 @@ Component WorldAndPotentials(const Grid<char>& grid, const Model& model, const r
     Component tabview;
     GridScroll<int> grid_scroll = { 0, 0 };
 
-    Impl(const Grid<char>& grid, const Model& _model, const render::Palette& _palette)
+    Impl(const Grid<symbol>& grid, const Model& _model, const render::Palette& _palette)
     : model{ _model },
       palette{ _palette },
       tabnames{ { "World" } },
@@ -385,7 +376,8 @@ Component WorldAndPotentials(const Grid<char>& grid, const Model& model, const r
 
       if ((node == nullptr and r == nullptr)
        or (node == r and stdr::equal(
-            stdv::keys(r->potentials)
+            r->potentials.symbols()
+              | stdv::transform([&symbols = model.symbols](auto s) { return symbols[s]; })
               | stdr::to<std::set>(),
             tabnames | stdv::drop(1)
               | stdv::transform([](const auto& n) { return n[0]; })
@@ -406,21 +398,20 @@ Component WorldAndPotentials(const Grid<char>& grid, const Model& model, const r
           tabview->Add(Renderer([&future = *r->future, &palette = palette] {
             return render::grid(
               { std::from_range, future | stdv::transform([](const auto& s) noexcept {
-                return (s | stdr::to<std::vector>())[0];
+                return *stdr::begin(s);
               }), future.extents },
               palette
             );
           }));
         }
 
-        auto keys = stdv::keys(r->potentials) | stdr::to<std::vector>();
-        stdr::sort(keys, {}, [&symbols = model.symbols](const auto& s) {
-          return stdr::distance(stdr::begin(symbols), stdr::find(symbols, s));
-        });
+        auto keys = r->potentials.symbols() | stdr::to<std::vector>();
+        stdr::sort(keys);
         for (auto sym : keys) {
-          const auto& p = r->potentials.at(sym);
-          tabnames.push_back(std::format("{}", sym));
-          tabview->Add(Renderer([&p] { return render::potential(p); }));
+          tabnames.push_back(std::format("{}", model.symbols[sym]));
+          tabview->Add(Renderer([&potentials = r->potentials, sym] {
+            return render::potential(potentials.plane(sym));
+          }));
         }
       }
 
@@ -438,7 +429,7 @@ Component WorldAndPotentials(const Grid<char>& grid, const Model& model, const r
   return Make<Impl>(grid, model, palette);
 }
 
-Component MainView(const Grid<char>& grid, const Model& model, Controls& controls, const Palette& palette) {
+Component MainView(const Grid<symbol>& grid, const Model& model, Controls& controls, const Palette& palette) {
   return Container::Horizontal({
     Container::Vertical({
       Renderer([]{
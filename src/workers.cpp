@@ -0,0 +1,93 @@
+module workers;
+
+namespace stdr = std::ranges;
+
+namespace {
+
+/** Set on pool threads, on a caller while it takes its share and on threads marked inline */
+thread_local auto inlined = false;
+
+}
+
+Workers::Workers(std::size_t n) {
+  threads.reserve(n);
+  for (auto i = 0uz; i < n; ++i) {
+    threads.emplace_back([this](std::stop_token stop) {
+      inlined = true;
+      for (auto seen = 0uz;;) {
+        {
+          auto l = std::unique_lock{ m };
+          if (not wake.wait(l, stop, [this, seen] { return generation != seen; })) return;
+          seen = generation;
+        }
+
+        work();
+
+        {
+          auto l = std::lock_guard{ m };
+          if (--pending == 0) done.notify_one();
+        }
+      }
+    });
+  }
+}
+
+Workers::~Workers() {
+  for (auto& thread : threads) thread.request_stop();
+  wake.notify_all();
+}
+
+auto Workers::work() -> void {
+  for (auto i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+    (*task)(i);
+  }
+}
+
+auto Workers::parallel_for(std::size_t n, const Task& _task) -> void {
+  /* a nested or concurrent loop would wait on the pool it runs on, or queue behind another caller */
+  auto serial = std::unique_lock{ caller, std::defer_lock };
+  if (stdr::empty(threads) or n < 2 or inlined or not serial.try_lock()) {
+    for (auto i = 0uz; i < n; ++i) _task(i);
+    return;
+  }
+
+  const auto guard = Inline{};
+  {
+    auto l = std::lock_guard{ m };
+    task    = &_task;
+    count   = n;
+    next    = 0;
+    pending = stdr::size(threads);
+    ++generation;
+  }
+  wake.notify_all();
+
+  work();
+
+  auto l = std::unique_lock{ m };
+  done.wait(l, [this] { return pending == 0; });
+  task = nullptr;
+}
+
+auto Workers::parallel_ranges(std::size_t n, std::size_t grain, const RangeTask& _task) -> void {
+  parallel_for((n + grain - 1u) / grain, [n, grain, &_task](std::size_t chunk) {
+    _task(chunk * grain, std::min(n, (chunk + 1u) * grain));
+  });
+}
+
+auto Workers::size() const noexcept -> std::size_t {
+  return stdr::size(threads) + 1u;
+}
+
+auto Workers::shared() -> Workers& {
+  static auto workers = Workers{};
+  return workers;
+}
+
+Workers::Inline::Inline() noexcept : previous{ inlined } {
+  inlined = true;
+}
+
+Workers::Inline::~Inline() {
+  inlined = previous;
+}
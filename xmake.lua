@@ -75,12 +75,30 @@ if get_config("compile_commands") then
     add_rules("plugin.compile_commands.autoupdate", { outputdir = ".vscode", lsp = "clangd" })
 end
 
-target("markovjunior")
-    set_kind("binary")
+option("aot_models", { default = "", description = "Models baked into the binary by mjc, comma separated names from models/" })
+
+rule("markovjunior.model")
+    set_extensions(".xml")
+    before_buildcmd_file(function (target, batchcmds, sourcefile, opt)
+        local generated = path.join(target:autogendir(), "models", path.basename(sourcefile) .. ".cpp")
+        local objectfile = target:objectfile(generated)
+        table.insert(target:objectfiles(), objectfile)
+
+        batchcmds:show_progress(opt.progress, "${color.build.object}compiling.model %s", sourcefile)
+        batchcmds:mkdir(path.directory(generated))
+        batchcmds:vrunv(target:dep("mjc"):targetfile(), { sourcefile, generated })
+        batchcmds:compile(generated, objectfile)
+
+        batchcmds:add_depfiles(sourcefile, target:dep("mjc"):targetfile())
+        batchcmds:set_depmtime(os.mtime(objectfile))
+        batchcmds:set_depcache(target:dependfile(objectfile))
+    end)
+
+target("engine")
+    set_kind("static")
 
-    add_packages("stormkit", { components = { "core", "log", "wsi", "gpu", "image" } })
+    add_packages("stormkit", { components = { "core", "log", "wsi", "gpu", "image" }, public = true })
 
-    -- stormkit deps, remove when handled by xmake
     add_packages(
         "glm",
         "frozen",
@@ -91,11 +109,43 @@ target("markovjunior")
         "cpptrace",
 
         "pugixml",
+        { public = true }
+    )
+
+    add_files("lib/**.mpp", "src/*.mpp", "src/engine/**.mpp", "src/parser/**.mpp", { public = true })
+    add_files("src/*.cpp", "src/engine/**.cpp", "src/parser/**.cpp")
+    remove_files("src/main.cpp", "src/mjc.cpp", "src/selftest.cpp")
+    add_includedirs("src", { public = true })
+
+target("mjc")
+    set_kind("binary")
+    add_deps("engine")
+
+    add_files("src/compiler/**.mpp", "src/compiler/**.cpp", "src/mjc.cpp")
+
+target("selftest")
+    set_kind("binary")
+    set_default(false)
+    add_deps("engine")
+
+    add_files("src/selftest.cpp")
+    set_rundir("$(projectdir)")
+    add_tests("default")
+
+target("markovjunior")
+    set_kind("binary")
+    add_deps("engine", "mjc")
+    add_rules("markovjunior.model")
+
+    add_packages(
         "ftxui",
         "imgui"
     )
 
-    add_files("lib/**.mpp", "src/**.mpp", "src/**.cpp")
+    add_files("src/tui/**.mpp", "src/tui/**.cpp", "src/gui/**.mpp", "src/gui/**.cpp", "src/headless/**.mpp", "src/headless/**.cpp", "src/main.cpp")
+    for _, name in ipairs((get_config("aot_models") or ""):split(",")) do
+        add_files(path.join("models", name .. ".xml"))
+    end
     set_rundir("$(projectdir)")
 
     if is_plat("macosx") then